@@ -1,5 +1,10 @@
 #include <assert.h>
 #include "aes.h"
+#include "cpu_features.h"
+
+#ifdef GRIMM_CPU_X86
+#	include <immintrin.h>
+#endif // GRIMM_CPU_X86
 
 /*
 *  FIPS-197 compliant AES implementation
@@ -822,27 +827,95 @@ void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 	m_nBuf -= (uint8_t) nSize;
 }
 
-void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
+#ifdef GRIMM_CPU_X86
+
+// CTR keystream with AES-NI, 8 blocks in parallel to hide the aesenc latency.
+// Our round keys are stored as big-endian words, hence swapped to the byte order on load.
+GRIMM_TARGET("aes,ssse3")
+static void XCryptBlocksNi(const uint32_t* pRK, grimm::uintBig_t<AES::s_BlockSize>& ctr, uint8_t* pBuf, uint32_t nBlocks)
 {
-	while (true)
+	const __m128i bswap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+
+	__m128i pKey[AES::Nr + 1];
+	for (int r = 0; r <= AES::Nr; r++)
+		pKey[r] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pRK + (r << 2))), bswap);
+
+	const uint32_t nPar = 8;
+	__m128i pX[nPar];
+
+	while (nBlocks)
 	{
-		if (!m_nBuf)
+		uint32_t n = std::min(nBlocks, nPar);
+
+		for (uint32_t j = 0; j < n; j++)
 		{
-			enc.Proceed(m_pBuf, m_Counter.m_pData);
-			m_nBuf = _countof(m_pBuf);
-			m_Counter.Inc();
+			pX[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctr.m_pData)), pKey[0]);
+			ctr.Inc();
 		}
 
-		if (m_nBuf >= nSize)
+		for (int r = 1; r < AES::Nr; r++)
+			for (uint32_t j = 0; j < n; j++)
+				pX[j] = _mm_aesenc_si128(pX[j], pKey[r]);
+
+		for (uint32_t j = 0; j < n; j++)
 		{
-			PerfXor(pBuf, nSize);
-			break;
+			__m128i* p = reinterpret_cast<__m128i*>(pBuf) + j;
+			__m128i x = _mm_aesenclast_si128(pX[j], pKey[AES::Nr]);
+			_mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), x));
 		}
 
-		uint8_t n = m_nBuf;
-		PerfXor(pBuf, m_nBuf);
+		pBuf += n * AES::s_BlockSize;
+		nBlocks -= n;
+	}
+}
+
+#endif // GRIMM_CPU_X86
+
+void AES::StreamCipher::XCryptBlocks(const Encoder& enc, uint8_t* pBuf, uint32_t nBlocks)
+{
+#ifdef GRIMM_CPU_X86
+	if (grimm::CpuFeatures::get().m_Aes)
+	{
+		XCryptBlocksNi(enc.m_erk, m_Counter, pBuf, nBlocks);
+		return;
+	}
+#endif // GRIMM_CPU_X86
 
+	for (; nBlocks--; pBuf += s_BlockSize)
+	{
+		uint8_t pKs[s_BlockSize];
+		enc.Proceed(pKs, m_Counter.m_pData);
+		m_Counter.Inc();
+		memxor(pBuf, pKs, s_BlockSize);
+	}
+}
+
+void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
+{
+	// the remaining keystream of the last block
+	uint32_t n = std::min(nSize, static_cast<uint32_t>(m_nBuf));
+	if (n)
+	{
+		PerfXor(pBuf, n);
 		pBuf += n;
 		nSize -= n;
 	}
+
+	// whole blocks, the bulk of the data
+	n = nSize / s_BlockSize;
+	if (n)
+	{
+		XCryptBlocks(enc, pBuf, n);
+		pBuf += n * s_BlockSize;
+		nSize -= n * s_BlockSize;
+	}
+
+	if (nSize)
+	{
+		enc.Proceed(m_pBuf, m_Counter.m_pData);
+		m_nBuf = _countof(m_pBuf);
+		m_Counter.Inc();
+
+		PerfXor(pBuf, nSize);
+	}
 }
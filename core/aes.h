@@ -31,6 +31,7 @@ struct AES
 		uint8_t m_nBuf;
 
 		void PerfXor(uint8_t* pBuf, uint32_t nSize);
+		void XCryptBlocks(const Encoder&, uint8_t* pBuf, uint32_t nBlocks); // AES-NI if available
 
 		void Reset();
 		void XCrypt(const Encoder&, uint8_t* pBuf, uint32_t nSize);
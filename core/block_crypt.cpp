@@ -742,7 +742,7 @@ namespace grimm
 	bool Transaction::IsValid(Context& ctx) const
 	{
 		return
-			ctx.ValidateAndSummarize(*this, get_Reader()) &&
+			ctx.ValidateAndSummarizeBatched(*this, get_Reader()) &&
 			ctx.IsValidTransaction();
 	}
 
@@ -1324,7 +1324,7 @@ namespace grimm
 		ctx.m_Height = hr;
 
 		return
-			ctx.ValidateAndSummarize(*this, std::move(r)) &&
+			ctx.ValidateAndSummarizeBatched(*this, std::move(r)) &&
 			ctx.IsValidBlock();
 	}
 
@@ -682,6 +682,7 @@ namespace grimm
 		bool ShouldAbort() const;
 
 		bool HandleElementHeight(const HeightRange&);
+		bool ValidateElements(Height hScheme, IReader&) const;
 
 	public:
 		// Tests the validity of all the components, overall arithmetics, and the lexicographical order of the components.
@@ -736,6 +737,11 @@ namespace grimm
 		void Reset();
 
 		bool ValidateAndSummarize(const TxBase&, IReader&&);
+
+		// Same as above, but the range proofs and signatures are verified in a single multi-exponentiation, unless the caller has already installed a batch.
+		// If the batch fails - the elements are re-verified one by one, and the offending one is logged.
+		bool ValidateAndSummarizeBatched(const TxBase&, IReader&&);
+
 		bool Merge(const Context&);
 
 		// hi-level functions, should be used after all parts were validated and merged
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "block_crypt.h"
+#include "utility/logger.h"
 
 namespace grimm
 {
@@ -211,6 +212,78 @@ namespace grimm
 		return true;
 	}
 
+	bool TxBase::Context::ValidateAndSummarizeBatched(const TxBase& txb, IReader&& r)
+	{
+		if (ECC::InnerProduct::BatchContext::s_pInstance)
+			return ValidateAndSummarize(txb, std::move(r)); // the caller is responsible to flush it
+
+		typedef ECC::InnerProduct::BatchContextEx<4> MyBatch;
+		static thread_local MyBatch s_Bc; // reused, it's too big to construct per call
+
+		Height hScheme = m_Height.m_Min; // may be narrowed by the elements
+
+		{
+			MyBatch::Scope scope(s_Bc);
+			if (!ValidateAndSummarize(txb, std::move(r)))
+			{
+				s_Bc.Reset();
+				return false;
+			}
+		}
+
+		if (s_Bc.Flush())
+			return true;
+
+		return ValidateElements(hScheme, r);
+	}
+
+	bool TxBase::Context::ValidateElements(Height hScheme, IReader& r) const
+	{
+		// per-element fallback, pin down the offending one (no batch is installed at this point)
+		ECC::Mode::Scope scope(ECC::Mode::Fast);
+		uint32_t iV = m_iVerifier;
+
+		r.Reset();
+		for (; r.m_pUtxoIn; r.NextUtxoIn())
+			ShouldVerify(iV);
+
+		ECC::Point::Native pt;
+		uint32_t i = 0;
+
+		for (r.Reset(); r.m_pUtxoOut; r.NextUtxoOut(), i++)
+		{
+			if (!ShouldVerify(iV))
+				continue;
+
+			const Output& v = *r.m_pUtxoOut;
+			if ((v.m_pConfidential || v.m_pPublic) && !v.IsValid(hScheme, pt))
+			{
+				LOG_WARNING() << "Output " << i << " invalid: " << v.m_Commitment;
+				return false;
+			}
+		}
+
+		i = 0;
+		for (; r.m_pKernel; r.NextKernel(), i++)
+		{
+			if (!ShouldVerify(iV))
+				continue;
+
+			AmountBig::Type fee = Zero;
+			ECC::Point::Native exc = Zero;
+
+			if (!r.m_pKernel->IsValid(hScheme, fee, exc))
+			{
+				Merkle::Hash hv;
+				r.m_pKernel->get_ID(hv);
+				LOG_WARNING() << "Kernel " << i << " invalid: " << hv;
+				return false;
+			}
+		}
+
+		return true; // all the elements are valid by themselves
+	}
+
 	bool TxBase::Context::IsValidTransaction()
 	{
 		assert(m_Coinbase == Zero); // must have already been checked
@@ -0,0 +1,84 @@
+// Copyright 2018 The Beam Team / Copyright 2019 The Grimm Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "cpu_features.h"
+#include <stdint.h>
+
+#ifdef GRIMM_CPU_X86
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	else
+#		include <cpuid.h>
+#	endif
+#endif // GRIMM_CPU_X86
+
+namespace grimm
+{
+#ifdef GRIMM_CPU_X86
+
+	static void CpuId(uint32_t* pRegs, uint32_t nLeaf)
+	{
+		// eax, ebx, ecx, edx
+#ifdef _MSC_VER
+		int pVal[4];
+		__cpuidex(pVal, static_cast<int>(nLeaf), 0);
+		for (int i = 0; i < 4; i++)
+			pRegs[i] = static_cast<uint32_t>(pVal[i]);
+#else
+		__cpuid_count(nLeaf, 0, pRegs[0], pRegs[1], pRegs[2], pRegs[3]);
+#endif
+	}
+
+	static CpuFeatures Detect()
+	{
+		CpuFeatures ret;
+
+		uint32_t pRegs[4];
+		CpuId(pRegs, 0);
+		uint32_t nMaxLeaf = pRegs[0];
+
+		if (nMaxLeaf >= 1)
+		{
+			CpuId(pRegs, 1);
+			bool bSsse3 = 0 != ((1U << 9) & pRegs[2]);
+			bool bSse41 = 0 != ((1U << 19) & pRegs[2]);
+			bool bAes = 0 != ((1U << 25) & pRegs[2]);
+
+			ret.m_Aes = bAes && bSsse3;
+
+			if (bSse41 && bSsse3 && (nMaxLeaf >= 7))
+			{
+				CpuId(pRegs, 7);
+				ret.m_Sha = 0 != ((1U << 29) & pRegs[1]);
+			}
+		}
+
+		return ret;
+	}
+
+#else // GRIMM_CPU_X86
+
+	static CpuFeatures Detect()
+	{
+		return CpuFeatures();
+	}
+
+#endif // GRIMM_CPU_X86
+
+	CpuFeatures& CpuFeatures::get()
+	{
+		static CpuFeatures s_Val = Detect();
+		return s_Val;
+	}
+}
@@ -0,0 +1,38 @@
+// Copyright 2018 The Beam Team / Copyright 2019 The Grimm Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define GRIMM_CPU_X86
+#	ifdef _MSC_VER
+#		define GRIMM_TARGET(x)
+#	else
+#		define GRIMM_TARGET(x) __attribute__((target(x)))
+#	endif
+#endif // x86
+
+namespace grimm
+{
+	// CPU extensions used by the crypto kernels, detected at runtime.
+	// The kernels are compiled with per-function target attributes, no special compiler flags are needed.
+	struct CpuFeatures
+	{
+		bool m_Aes = false; // AES-NI (with SSSE3)
+		bool m_Sha = false; // SHA extensions (with SSE4.1)
+
+		// Detected once. May be switched off (i.e. by tests), to fall back to the portable code
+		static CpuFeatures& get();
+	};
+}
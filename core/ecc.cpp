@@ -14,6 +14,7 @@
 
 #include "common.h"
 #include "ecc_native.h"
+#include "cpu_features.h"
 
 #if defined(__clang__) || defined(__GNUC__) || defined(__GNUG__)
 #	pragma GCC diagnostic push
@@ -35,6 +36,10 @@
 #	pragma warning (pop)
 #endif
 
+#ifdef GRIMM_CPU_X86
+#	include <immintrin.h>
+#endif // GRIMM_CPU_X86
+
 #ifdef WIN32
 #	pragma comment (lib, "Bcrypt.lib")
 #else // WIN32
@@ -310,6 +315,137 @@ namespace ECC {
 		SetInv(*this);
 	}
 
+	/////////////////////
+	// SHA-256 block compression. secp256k1 code is used for padding and finalization, the bulk goes through here
+
+#ifdef GRIMM_CPU_X86
+
+	// SHA extensions. State is kept in the secp256k1 layout (a..h), rearranged to ABEF/CDGH per call
+	GRIMM_TARGET("sha,sse4.1,ssse3")
+	static void Sha256TransformNi(uint32_t* pS, const uint8_t* pData, size_t nBlocks)
+	{
+		alignas(16) static const uint32_t pK[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+		__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pS)), 0xB1); // CDAB
+		__m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pS + 4)), 0x1B); // EFGH
+		__m128i s0 = _mm_alignr_epi8(tmp, s1, 8); // ABEF
+		s1 = _mm_blend_epi16(s1, tmp, 0xF0); // CDGH
+
+		for (; nBlocks--; pData += 64)
+		{
+			__m128i s0Save = s0;
+			__m128i s1Save = s1;
+			__m128i pM[4];
+			__m128i msg;
+
+			// 4 rounds. The message schedule is computed 2 groups ahead (msg1) and 1 group ahead (msg2)
+#define THE_MACRO(i, bMsg1, bMsg2) \
+			msg = _mm_add_epi32(pM[i & 3], _mm_load_si128(reinterpret_cast<const __m128i*>(pK) + i)); \
+			s1 = _mm_sha256rnds2_epu32(s1, s0, msg); \
+			if (bMsg2) \
+			{ \
+				pM[(i + 1) & 3] = _mm_add_epi32(pM[(i + 1) & 3], _mm_alignr_epi8(pM[i & 3], pM[(i + 3) & 3], 4)); \
+				pM[(i + 1) & 3] = _mm_sha256msg2_epu32(pM[(i + 1) & 3], pM[i & 3]); \
+			} \
+			s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(msg, 0x0E)); \
+			if (bMsg1) \
+				pM[(i + 3) & 3] = _mm_sha256msg1_epu32(pM[(i + 3) & 3], pM[i & 3]);
+
+			for (int i = 0; i < 4; i++)
+				pM[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pData) + i), bswap);
+
+			THE_MACRO(0, false, false)
+			THE_MACRO(1, true, false)
+			THE_MACRO(2, true, false)
+			THE_MACRO(3, true, true)
+			THE_MACRO(4, true, true)
+			THE_MACRO(5, true, true)
+			THE_MACRO(6, true, true)
+			THE_MACRO(7, true, true)
+			THE_MACRO(8, true, true)
+			THE_MACRO(9, true, true)
+			THE_MACRO(10, true, true)
+			THE_MACRO(11, true, true)
+			THE_MACRO(12, true, true)
+			THE_MACRO(13, false, true)
+			THE_MACRO(14, false, true)
+			THE_MACRO(15, false, false)
+#undef THE_MACRO
+
+			s0 = _mm_add_epi32(s0, s0Save);
+			s1 = _mm_add_epi32(s1, s1Save);
+		}
+
+		tmp = _mm_shuffle_epi32(s0, 0x1B); // FEBA
+		s1 = _mm_shuffle_epi32(s1, 0xB1); // DCHG
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pS), _mm_blend_epi16(tmp, s1, 0xF0)); // DCBA
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pS + 4), _mm_alignr_epi8(s1, tmp, 8)); // HGFE
+	}
+
+#endif // GRIMM_CPU_X86
+
+	static void Sha256Transform(uint32_t* pS, const uint8_t* pData, size_t nBlocks)
+	{
+#ifdef GRIMM_CPU_X86
+		if (grimm::CpuFeatures::get().m_Sha)
+		{
+			Sha256TransformNi(pS, pData, nBlocks);
+			return;
+		}
+#endif // GRIMM_CPU_X86
+
+		for (; nBlocks--; pData += 64)
+		{
+			uint32_t pChunk[16]; // secp256k1 expects an aligned chunk
+			memcpy(pChunk, pData, sizeof(pChunk));
+			secp256k1_sha256_transform(pS, pChunk);
+		}
+	}
+
+	static void Sha256Write(secp256k1_sha256_t& x, const uint8_t* p, size_t n)
+	{
+		// same as secp256k1_sha256_write, but the whole blocks are compressed directly from the source
+		size_t nBuf = x.bytes & 0x3F;
+		x.bytes += n;
+
+		if (nBuf)
+		{
+			size_t nFill = 64 - nBuf;
+			if (n < nFill)
+			{
+				memcpy(reinterpret_cast<uint8_t*>(x.buf) + nBuf, p, n);
+				return;
+			}
+
+			memcpy(reinterpret_cast<uint8_t*>(x.buf) + nBuf, p, nFill);
+			Sha256Transform(x.s, reinterpret_cast<const uint8_t*>(x.buf), 1);
+			p += nFill;
+			n -= nFill;
+		}
+
+		size_t nBlocks = n >> 6;
+		if (nBlocks)
+		{
+			Sha256Transform(x.s, p, nBlocks);
+			p += nBlocks << 6;
+			n &= 0x3F;
+		}
+
+		if (n)
+			memcpy(x.buf, p, n);
+	}
+
 	/////////////////////
 	// Hash
 	Hash::Processor::Processor()
@@ -332,7 +468,7 @@ namespace ECC {
 	void Hash::Processor::Write(const void* p, uint32_t n)
 	{
 		assert(m_bInitialized);
-		secp256k1_sha256_write(this, (const uint8_t*) p, n);
+		Sha256Write(*this, (const uint8_t*) p, n);
 	}
 
 	void Hash::Processor::Finalize(Value& v)
@@ -389,7 +525,7 @@ namespace ECC {
 
 	void Hash::Mac::Write(const void* p, uint32_t n)
 	{
-		secp256k1_hmac_sha256_write(this, (uint8_t*)p, n);
+		Sha256Write(inner, (const uint8_t*) p, n);
 	}
 
 	void Hash::Mac::Finalize(Value& hv)
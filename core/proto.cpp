@@ -308,6 +308,275 @@ bool NotCalled_VerifyNoDuplicatedIDs(uint32_t id)
     return false;
 }
 
+/////////////////////////
+// IoThreads
+void IoThreads::OnTask(Task&& task)
+{
+    Task t(std::move(task)); // don't keep its captures in the queue
+    t();
+}
+
+IoThreads::IoThreads(uint32_t nThreads)
+{
+    assert(nThreads);
+
+    m_pRxBack = std::make_unique<RX<Task> >(io::Reactor::get_Current(), OnTask, s_QueueCapacity);
+    m_pTxBack = std::make_unique<TX<Task> >(m_pRxBack->get_tx());
+
+    m_vThreads.resize(nThreads);
+    for (uint32_t i = 0; i < nThreads; i++)
+    {
+        PerThread& pt = m_vThreads[i];
+        pt.m_pReactor = io::Reactor::create();
+        pt.m_pRx = std::make_unique<RX<Task> >(*pt.m_pReactor, OnTask, s_QueueCapacity);
+        pt.m_pTx = std::make_unique<TX<Task> >(pt.m_pRx->get_tx());
+
+        io::Reactor::Ptr pReactor = pt.m_pReactor;
+        pt.m_Thread = std::thread([pReactor]() {
+            io::Reactor::Scope scope(*pReactor);
+            pReactor->run();
+        });
+    }
+}
+
+IoThreads::~IoThreads()
+{
+    for (size_t i = 0; i < m_vThreads.size(); i++)
+    {
+        // after the already posted tasks (i.e. closing the connections)
+        io::Reactor::Ptr pReactor = m_vThreads[i].m_pReactor;
+        Post(static_cast<uint32_t>(i), [pReactor]() { pReactor->stop(); });
+    }
+
+    for (size_t i = 0; i < m_vThreads.size(); i++)
+    {
+        PerThread& pt = m_vThreads[i];
+        if (pt.m_Thread.joinable())
+            pt.m_Thread.join();
+    }
+
+    // pending tasks hold the connections, release them while the reactors are still there
+    m_pTxBack.reset();
+    m_pRxBack.reset();
+
+    for (size_t i = 0; i < m_vThreads.size(); i++)
+    {
+        PerThread& pt = m_vThreads[i];
+        pt.m_pTx.reset();
+        pt.m_pRx.reset();
+    }
+}
+
+uint32_t IoThreads::Select()
+{
+    uint32_t iThread = m_iNext;
+    m_iNext = (m_iNext + 1) % static_cast<uint32_t>(m_vThreads.size());
+    return iThread;
+}
+
+void IoThreads::Post(uint32_t iThread, Task&& task)
+{
+    m_vThreads[iThread].m_pTx->send(std::move(task));
+}
+
+void IoThreads::PostBack(Task&& task)
+{
+    m_pTxBack->send(std::move(task));
+}
+
+/////////////////////////
+// NodeConnection::IoLink
+// The connection in the I/O thread. Messages are decrypted and deserialized there, and posted to the owner.
+// The incoming cipher is set by the owner when it handles SChannelReady, till then the following data is held.
+struct NodeConnection::IoLink
+    :public IErrorHandler
+    ,public std::enable_shared_from_this<IoLink>
+{
+    IoThreads& m_Threads;
+    uint32_t m_iThread;
+    io::Address m_PeerAddress;
+
+    NodeConnection* m_pOwner; // accessed in the owner's thread only, reset once detached
+
+    std::atomic<size_t> m_Queued; // posted for sending, not written to the stream yet
+    std::atomic<size_t> m_Unsent; // written to the stream, not sent yet
+
+    // accessed in the I/O thread only
+    ProtocolPlus m_Protocol; // incoming direction
+    std::unique_ptr<Connection> m_pConnection;
+
+    IoLink(NodeConnection& owner, const io::Address& addr);
+
+    void Post(IoThreads::Task&& task) { m_Threads.Post(m_iThread, std::move(task)); }
+
+    // owner's thread
+    void Write(SerializedMsg&);
+    void Resume();
+    void Detach();
+
+    // I/O thread
+    void OnOpen(uv_os_sock_t);
+    void OnWrite(const SerializedMsg&, size_t nSize);
+    void OnResume(const AES::Encoder&, const AES::StreamCipher&, const ECC::Hash::Mac&);
+
+    template <typename T>
+    bool OnMsgIo(uint64_t, T&& v);
+
+    // IErrorHandler
+    virtual void on_protocol_error(uint64_t, ProtocolError error) override;
+    virtual void on_connection_error(uint64_t, io::ErrorCode errorCode) override;
+};
+
+NodeConnection::IoLink::IoLink(NodeConnection& owner, const io::Address& addr)
+    :m_Threads(*owner.m_pIoThreads)
+    ,m_iThread(owner.m_pIoThreads->Select())
+    ,m_PeerAddress(addr)
+    ,m_pOwner(&owner)
+    ,m_Queued(0)
+    ,m_Unsent(0)
+    ,m_Protocol('G', 'm', 10, sizeof(HighestMsgCode), *this, 20000)
+{
+#define THE_MACRO(code, msg) \
+    m_Protocol.add_message_handler<IoLink, msg##_NoInit, &IoLink::OnMsgIo<msg##_NoInit> >(uint8_t(code), this, 0, 1024*1024*10);
+
+    GrimmNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+}
+
+void NodeConnection::IoLink::Write(SerializedMsg& sm)
+{
+    size_t nSize = 0;
+    for (size_t i = 0; i < sm.size(); i++)
+        nSize += sm[i].size;
+
+    m_Queued += nSize;
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    std::shared_ptr<SerializedMsg> pMsg = std::make_shared<SerializedMsg>();
+    pMsg->swap(sm);
+
+    Post([pThis, pMsg, nSize]() { pThis->OnWrite(*pMsg, nSize); });
+}
+
+void NodeConnection::IoLink::Resume()
+{
+    const ProtocolPlus& p = m_pOwner->m_Protocol;
+    if (ProtocolPlus::Mode::Duplex != p.m_Mode)
+        return; // not established, the connection is about to be closed
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    AES::Encoder enc = p.m_Enc;
+    AES::StreamCipher cipher = p.m_CipherIn;
+    ECC::Hash::Mac hmac = p.m_HMac;
+
+    Post([pThis, enc, cipher, hmac]() { pThis->OnResume(enc, cipher, hmac); });
+}
+
+void NodeConnection::IoLink::Detach()
+{
+    m_pOwner = nullptr;
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    Post([pThis]() { pThis->m_pConnection.reset(); });
+}
+
+void NodeConnection::IoLink::OnOpen(uv_os_sock_t sock)
+{
+    io::TcpStream::Ptr pStream = m_Threads.get_Reactor(m_iThread).attach_tcpstream(sock);
+    if (!pStream)
+    {
+        on_connection_error(0, io::EC_ENOTCONN);
+        return;
+    }
+
+    pStream->set_write_callback([this](const io::TcpStream::State& s) { m_Unsent = s.unsent; });
+
+    m_pConnection = std::make_unique<Connection>(
+        m_Protocol,
+        uint64_t(this),
+        Connection::inbound,
+        100,
+        std::move(pStream)
+        );
+}
+
+void NodeConnection::IoLink::OnWrite(const SerializedMsg& sm, size_t nSize)
+{
+    if (m_pConnection)
+    {
+        io::Result res = m_pConnection->write_msg(sm);
+        if (res)
+            m_Unsent = m_pConnection->get_Unsent();
+        else
+            on_connection_error(0, res.error());
+    }
+
+    m_Queued -= nSize;
+}
+
+void NodeConnection::IoLink::OnResume(const AES::Encoder& enc, const AES::StreamCipher& cipher, const ECC::Hash::Mac& hmac)
+{
+    m_Protocol.m_Enc = enc;
+    m_Protocol.m_CipherIn = cipher;
+    m_Protocol.m_HMac = hmac;
+    m_Protocol.m_Mode = ProtocolPlus::Mode::Duplex;
+
+    if (m_pConnection)
+        m_pConnection->resume();
+}
+
+template <typename T>
+bool NodeConnection::IoLink::OnMsgIo(uint64_t, T&& v)
+{
+    bool bResume = false;
+    if constexpr (std::is_same<T, SChannelReady_NoInit>::value)
+    {
+        // the following data is encrypted, wait for the cipher
+        if (ProtocolPlus::Mode::Duplex != m_Protocol.m_Mode)
+        {
+            m_pConnection->suspend();
+            bResume = true;
+        }
+    }
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    std::shared_ptr<T> pMsg = std::make_shared<T>(std::move(v));
+
+    m_Threads.PostBack([pThis, pMsg, bResume]() {
+        if (!pThis->m_pOwner)
+            return;
+
+        pThis->m_pOwner->OnMsgInternal(0, std::move(*pMsg));
+
+        if (bResume && pThis->m_pOwner)
+            pThis->Resume();
+    });
+
+    return true;
+}
+
+void NodeConnection::IoLink::on_protocol_error(uint64_t, ProtocolError error)
+{
+    m_pConnection.reset();
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    m_Threads.PostBack([pThis, error]() {
+        if (pThis->m_pOwner)
+            pThis->m_pOwner->on_protocol_error(0, error);
+    });
+}
+
+void NodeConnection::IoLink::on_connection_error(uint64_t, io::ErrorCode errorCode)
+{
+    m_pConnection.reset();
+
+    std::shared_ptr<IoLink> pThis = shared_from_this();
+    m_Threads.PostBack([pThis, errorCode]() {
+        if (pThis->m_pOwner)
+            pThis->m_pOwner->on_connection_error(0, errorCode);
+    });
+}
+
 /////////////////////////
 // NodeConnection
 NodeConnection::NodeConnection()
@@ -341,6 +610,12 @@ void NodeConnection::Reset()
     m_Connection = NULL;
     m_pAsyncFail = NULL;
 
+    if (m_pIoLink)
+    {
+        m_pIoLink->Detach();
+        m_pIoLink.reset();
+    }
+
     m_Protocol.ResetVars();
 }
 
@@ -388,7 +663,7 @@ void NodeConnection::OnConnectInternal(uint64_t tag, io::TcpStream::Ptr&& newStr
 
 void NodeConnection::OnConnectInternal2(io::TcpStream::Ptr&& newStream, io::ErrorCode status)
 {
-    assert(!m_Connection && m_ConnectPending);
+    assert(!m_Connection && !m_pIoLink && m_ConnectPending);
     m_ConnectPending = false;
 
     if (newStream)
@@ -437,9 +712,20 @@ void NodeConnection::OnIoErr(io::ErrorCode err)
 
 size_t NodeConnection::get_Unsent() const
 {
+	if (m_pIoLink)
+		return m_pIoLink->m_Queued + m_pIoLink->m_Unsent;
+
 	return m_Connection ? m_Connection->get_Unsent() : 0;
 }
 
+io::Address NodeConnection::get_PeerAddress() const
+{
+	if (m_pIoLink)
+		return m_pIoLink->m_PeerAddress;
+
+	return m_Connection ? m_Connection->peer_address() : io::Address();
+}
+
 void NodeConnection::on_protocol_error(uint64_t, ProtocolError error)
 {
     Reset();
@@ -493,7 +779,7 @@ void NodeConnection::ThrowUnexpected(const char* sz, NodeProcessingException::Ty
 
 void NodeConnection::Connect(const io::Address& addr)
 {
-    assert(!m_Connection && !m_ConnectPending);
+    assert(!m_Connection && !m_pIoLink && !m_ConnectPending);
 
     io::Result res = io::Reactor::get_Current().tcp_connect(
         addr,
@@ -506,10 +792,13 @@ void NodeConnection::Connect(const io::Address& addr)
 
 void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
 {
-    assert(!m_Connection && !m_ConnectPending);
+    assert(!m_Connection && !m_pIoLink && !m_ConnectPending);
 
     newStream->enable_keepalive(Rules::get().DA.Target_s); // it should be comparable to the block rate
 
+    if (m_pIoThreads && AcceptIo(newStream))
+        return;
+
     m_Connection = std::make_unique<Connection>(
         m_Protocol,
         uint64_t(this),
@@ -519,24 +808,60 @@ void NodeConnection::Accept(io::TcpStream::Ptr&& newStream)
         );
 }
 
+bool NodeConnection::AcceptIo(io::TcpStream::Ptr& newStream)
+{
+    io::Address addr = newStream->peer_address();
+
+    uv_os_sock_t sock;
+    io::Result res = newStream->detach_socket(sock);
+    if (!res)
+    {
+        LOG_WARNING() << "Can't move connection to the I/O thread: " << io::error_str(res.error());
+        return false;
+    }
+    newStream.reset();
+
+    m_pIoLink = std::make_shared<IoLink>(*this, addr);
+
+    std::shared_ptr<IoLink> pLink = m_pIoLink;
+    pLink->Post([pLink, sock]() { pLink->OnOpen(sock); });
+
+    return true;
+}
+
 bool NodeConnection::IsLive() const
 {
-    return m_Connection && !m_pAsyncFail;
+    return (m_Connection || m_pIoLink) && !m_pAsyncFail;
+}
+
+template <typename T>
+void NodeConnection::SendInternal(uint8_t code, const T& v)
+{
+    if (!IsLive())
+        return;
+    m_SerializeCache.clear();
+    MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, code, v);
+    m_Protocol.Encrypt(m_SerializeCache, ser);
+    io::Result res;
+    if (m_pIoLink)
+        m_pIoLink->Write(m_SerializeCache);
+    else
+        res = m_Connection->write_msg(m_SerializeCache);
+    m_SerializeCache.clear();
+
+    TestIoResultAsync(res);
+    TestNotDrown();
+}
+
+void NodeConnection::Send(const BodyPackRef& v)
+{
+    SendInternal(BodyPack::s_Code, v);
 }
 
 #define THE_MACRO(code, msg) \
 void NodeConnection::Send(const msg& v) \
 { \
-    if (!IsLive()) \
-        return; \
-    m_SerializeCache.clear(); \
-    MsgSerializer& ser = m_Protocol.serializeNoFinalize(m_SerializeCache, uint8_t(code), v); \
-    m_Protocol.Encrypt(m_SerializeCache, ser); \
-    io::Result res = m_Connection->write_msg(m_SerializeCache); \
-    m_SerializeCache.clear(); \
-\
-    TestIoResultAsync(res); \
-    TestNotDrown(); \
+    SendInternal(uint8_t(code), v); \
 } \
 \
 bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
@@ -745,7 +1070,7 @@ void NodeConnection::OnMsg(Login&& msg)
 void NodeConnection::OnLoginInternal(Height hScheme, Login&& msg)
 {
 	if ((~LoginFlags::Recognized) & msg.m_Flags) {
-		LOG_WARNING() << "Peer " << m_Connection->peer_address() << " Uses newer protocol.";
+		LOG_WARNING() << "Peer " << get_PeerAddress() << " Uses newer protocol.";
 	}
 	else
 	{
@@ -753,7 +1078,7 @@ void NodeConnection::OnLoginInternal(Height hScheme, Login&& msg)
 		uint32_t nFlags2 = nMask & msg.m_Flags;
 		if (nFlags2 != nMask)
 		{
-			LOG_WARNING() << "Peer " << m_Connection->peer_address() << " Uses older protocol: " << nFlags2;
+			LOG_WARNING() << "Peer " << get_PeerAddress() << " Uses older protocol: " << nFlags2;
 
 			hScheme = std::min(hScheme, Rules::get().pForks[1].m_Height - 1); // doesn't support extensions - must be before the 1st fork
 		}
@@ -761,7 +1086,7 @@ void NodeConnection::OnLoginInternal(Height hScheme, Login&& msg)
 
   if (hScheme < MaxHeight)
 	{
-		LOG_WARNING() << "Peer " << m_Connection->peer_address() << " incompatible with fork " << (hScheme + 1);
+		LOG_WARNING() << "Peer " << get_PeerAddress() << " incompatible with fork " << (hScheme + 1);
 
 		Height hMinScheme = get_MinPeerFork();
 		if (hScheme < hMinScheme)
@@ -23,6 +23,8 @@
 #include "../utility/io/timer.h"
 #include "aes.h"
 #include "block_crypt.h"
+#include <thread>
+#include <atomic>
 
 namespace grimm {
 namespace proto {
@@ -347,6 +349,21 @@ namespace proto {
 
 	};
 
+	// BodyPack made of shared bodies (i.e. cached by the node), without copying them into the message.
+	// Send-only, has the same wire format as BodyPack.
+	struct BodyPackRef
+	{
+		std::vector<std::shared_ptr<const BodyBuffers> > m_vBodies;
+
+		template <typename Archive>
+		void serialize(Archive& ar)
+		{
+			ar.write_seq_size(m_vBodies.size());
+			for (size_t i = 0; i < m_vBodies.size(); i++)
+				ar & *m_vBodies[i];
+		}
+	};
+
     enum Unused_ { Unused };
     enum Uninitialized_ { Uninitialized };
 
@@ -521,11 +538,52 @@ namespace proto {
         Type m_type;
     };
 
+    // Reactor threads for the connections' I/O. The connections attached to them read, decrypt and deserialize
+    // the messages there, only the handlers are invoked in the thread that created the pool.
+    class IoThreads
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        IoThreads(uint32_t nThreads); // must be created in the handlers' thread
+        ~IoThreads();
+
+        uint32_t Select(); // round-robin
+        io::Reactor& get_Reactor(uint32_t iThread) { return *m_vThreads[iThread].m_pReactor; }
+
+        void Post(uint32_t iThread, Task&&); // to the I/O thread
+        void PostBack(Task&&); // from I/O threads to the handlers' thread
+
+    private:
+        struct PerThread
+        {
+            io::Reactor::Ptr m_pReactor;
+            std::unique_ptr<RX<Task> > m_pRx;
+            std::unique_ptr<TX<Task> > m_pTx;
+            std::thread m_Thread;
+        };
+
+        std::vector<PerThread> m_vThreads;
+        uint32_t m_iNext = 0;
+
+        static constexpr size_t s_QueueCapacity = 4096; // all the connections' traffic goes through, per thread
+
+        static void OnTask(Task&&);
+
+        std::unique_ptr<RX<Task> > m_pRxBack;
+        std::unique_ptr<TX<Task> > m_pTxBack;
+    };
+
     class NodeConnection
         :public INodeMsgHandler
     {
         ProtocolPlus m_Protocol;
         std::unique_ptr<Connection> m_Connection;
+
+        struct IoLink;
+        std::shared_ptr<IoLink> m_pIoLink; // instead of m_Connection, if attached to IoThreads
+        bool AcceptIo(io::TcpStream::Ptr&);
+
         io::AsyncEvent::Ptr m_pAsyncFail;
         bool m_ConnectPending;
 		bool m_RulesCfgSent;
@@ -533,6 +591,7 @@ namespace proto {
 
         SerializedMsg m_SerializeCache;
 
+        template <typename T> void SendInternal(uint8_t code, const T& v);
         void TestIoResultAsync(const io::Result& res);
         void TestInputMsgContext(uint8_t);
 
@@ -547,6 +606,7 @@ namespace proto {
 #undef THE_MACRO
 
         void HashAddNonce(ECC::Hash::Processor&, bool bRemote);
+        io::Address get_PeerAddress() const;
 
 		void OnLoginInternal(Height hPeerMaxScheme, Login&&);
 
@@ -561,6 +621,8 @@ namespace proto {
         void Connect(const io::Address& addr);
         void Accept(io::TcpStream::Ptr&& newStream);
 
+        IoThreads* m_pIoThreads = nullptr; // optional, set before Connect/Accept
+
         // Secure-channel-specific
         void SecureConnect(); // must be connected already
 
@@ -648,6 +710,7 @@ namespace proto {
 #define THE_MACRO(code, msg) void Send(const msg& v);
         GrimmNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
+        void Send(const BodyPackRef& v);
 
         struct Server
         {
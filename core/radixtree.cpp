@@ -46,6 +46,8 @@ void RadixTree::Clear()
 		DeleteNode(m_pRoot);
 		m_pRoot = NULL;
 	}
+
+	OnCleared();
 }
 
 void RadixTree::DeleteNode(Node* p)
@@ -63,6 +65,86 @@ void RadixTree::DeleteNode(Node* p)
 	}
 }
 
+/////////////////////////////
+// RadixTree::SlabPool
+RadixTree::SlabPool::SlabPool(uint32_t nSize)
+	:m_pSlabs(NULL)
+	,m_pFree(NULL)
+	,m_nSize((std::max<uint32_t>(nSize, sizeof(FreeNode)) + s_Align - 1) & ~(s_Align - 1))
+	,m_Nodes(0)
+{
+}
+
+RadixTree::SlabPool::~SlabPool()
+{
+	Release();
+}
+
+void RadixTree::SlabPool::AddSlab()
+{
+	uint8_t* p = new uint8_t[s_Align + static_cast<size_t>(m_nSize) * s_NodesPerSlab];
+
+	Slab* pSlab = reinterpret_cast<Slab*>(p);
+	pSlab->m_pNext = m_pSlabs;
+	m_pSlabs = pSlab;
+
+	// push in reverse order, so that allocations go sequentially
+	p += s_Align;
+	for (uint32_t i = s_NodesPerSlab; i--; )
+	{
+		FreeNode* pF = reinterpret_cast<FreeNode*>(p + static_cast<size_t>(m_nSize) * i);
+		pF->m_pNext = m_pFree;
+		m_pFree = pF;
+	}
+}
+
+void* RadixTree::SlabPool::Alloc()
+{
+	if (!m_pFree)
+		AddSlab();
+
+	FreeNode* p = m_pFree;
+	m_pFree = p->m_pNext;
+	m_Nodes++;
+
+	return p;
+}
+
+void RadixTree::SlabPool::Free(void* p)
+{
+	assert(p && m_Nodes);
+
+	FreeNode* pF = reinterpret_cast<FreeNode*>(p);
+	pF->m_pNext = m_pFree;
+	m_pFree = pF;
+	m_Nodes--;
+}
+
+void RadixTree::SlabPool::Release()
+{
+	assert(!m_Nodes);
+
+	while (m_pSlabs)
+	{
+		Slab* p = m_pSlabs;
+		m_pSlabs = p->m_pNext;
+		delete[] reinterpret_cast<uint8_t*>(p);
+	}
+
+	m_pFree = NULL;
+}
+
+void RadixTree::SlabPool::get_Stats(Stats& st) const
+{
+	size_t nSlabs = 0;
+	for (const Slab* p = m_pSlabs; p; p = p->m_pNext)
+		nSlabs++;
+
+	st.m_Nodes += m_Nodes;
+	st.m_Slabs += nSlabs;
+	st.m_Bytes += nSlabs * (s_Align + static_cast<size_t>(m_nSize) * s_NodesPerSlab);
+}
+
 uint8_t RadixTree::CursorBase::get_BitRawStat(const uint8_t* p0, uint16_t nBit)
 {
 	return p0[nBit >> 3] >> (7 ^ (7 & nBit));
@@ -443,6 +525,11 @@ size_t RadixTree::Count() const
 
 /////////////////////////////
 // RadixHashTree
+void RadixHashTree::get_MemStats(SlabPool::Stats& st) const
+{
+	m_PoolJoints.get_Stats(st);
+}
+
 void RadixHashTree::get_Hash(Merkle::Hash& hv)
 {
 	Node* p = get_Root();
@@ -479,6 +566,37 @@ const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 	return x.m_Hash;
 }
 
+void RadixHashTree::Subtrees::Collect(RadixHashTree& t, uint16_t nDepth)
+{
+	Node* p = t.get_Root();
+	if (p)
+		CollectRec(*p, nDepth);
+}
+
+void RadixHashTree::Subtrees::CollectRec(Node& n, uint16_t nDepth)
+{
+	if ((Node::s_Clean | Node::s_Leaf) & n.m_Bits)
+		return; // leafs are hashed along with their parent
+
+	if (!nDepth)
+	{
+		m_v.push_back(&n);
+		return;
+	}
+
+	Joint& x = Cast::Up<Joint>(n);
+	for (size_t i = 0; i < _countof(x.m_ppC); i++)
+		CollectRec(*x.m_ppC[i], nDepth - 1);
+}
+
+void RadixHashTree::Subtrees::Hash(RadixHashTree& t, size_t i)
+{
+	assert(i < m_v.size());
+
+	Merkle::Hash hv;
+	t.get_Hash(*m_v[i], hv);
+}
+
 void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
 {
 	uint16_t n = cu.get_Depth();
@@ -504,8 +622,34 @@ void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
 	assert(proof.size() == nOut);
 }
 
+/////////////////////////////
+// RadixHashOnlyTree
+void RadixHashOnlyTree::get_MemStats(SlabPool::Stats& st) const
+{
+	RadixHashTree::get_MemStats(st);
+	m_PoolLeafs.get_Stats(st);
+}
+
+void RadixHashOnlyTree::OnCleared()
+{
+	RadixHashTree::OnCleared();
+	m_PoolLeafs.Release();
+}
+
 /////////////////////////////
 // UtxoTree
+void UtxoTree::get_MemStats(SlabPool::Stats& st) const
+{
+	RadixHashTree::get_MemStats(st);
+	m_PoolLeafs.get_Stats(st);
+}
+
+void UtxoTree::OnCleared()
+{
+	RadixHashTree::OnCleared();
+	m_PoolLeafs.Release();
+}
+
 void UtxoTree::MyLeaf::get_Hash(Merkle::Hash& hv, const Key& key, Input::Count nCount)
 {
 	ECC::Hash::Processor()
@@ -54,9 +54,67 @@ protected:
 	virtual uint8_t* GetLeafKey(const Leaf&) const = 0;
 	virtual void DeleteJoint(Joint*) = 0;
 	virtual void DeleteLeaf(Leaf*) = 0;
+	virtual void OnCleared() {} // all the nodes are deleted
 
 public:
 
+	// Fixed-size allocator for the tree nodes. Nodes are carved from slabs, deleted nodes are reused.
+	// Slabs are freed all at once, when the tree is cleared.
+	class SlabPool
+	{
+		struct Slab {
+			Slab* m_pNext;
+		};
+
+		struct FreeNode {
+			FreeNode* m_pNext;
+		};
+
+		Slab* m_pSlabs;
+		FreeNode* m_pFree;
+		const uint32_t m_nSize;
+		size_t m_Nodes; // in use
+
+		void AddSlab();
+
+	public:
+
+		static const uint32_t s_Align = 16; // also the slab header size
+		static const uint32_t s_NodesPerSlab = 256;
+
+		struct Stats
+		{
+			size_t m_Nodes;
+			size_t m_Slabs;
+			size_t m_Bytes;
+		};
+
+		SlabPool(uint32_t nSize);
+		~SlabPool();
+
+		void* Alloc();
+		void Free(void*);
+		void Release(); // all the nodes must be freed
+
+		void get_Stats(Stats&) const; // appends
+	};
+
+	template <typename T>
+	struct SlabPool_T
+		:public SlabPool
+	{
+		static_assert(alignof(T) <= s_Align, "");
+
+		SlabPool_T() :SlabPool(sizeof(T)) {}
+
+		T* New() { return new (Alloc()) T; }
+		void Delete(T* p)
+		{
+			p->~T();
+			Free(p);
+		}
+	};
+
 	RadixTree();
 	~RadixTree();
 
@@ -146,10 +204,28 @@ public:
 	void get_Hash(Merkle::Hash&);
 	void get_Proof(Merkle::Proof&, const CursorBase&);
 
+	virtual void get_MemStats(SlabPool::Stats&) const; // appends
+
+	// Dirty subtrees at the given depth are independent, and may be hashed concurrently.
+	// Once they're all hashed, get_Hash() only recalculates the top, the result is the same.
+	struct Subtrees
+	{
+		std::vector<Node*> m_v;
+
+		void Collect(RadixHashTree&, uint16_t nDepth);
+		void Hash(RadixHashTree&, size_t i);
+
+	private:
+		void CollectRec(Node&, uint16_t nDepth);
+	};
+
 protected:
+	SlabPool_T<MyJoint> m_PoolJoints;
+
 	// RadixTree
-	virtual Joint* CreateJoint() override { return new MyJoint; }
-	virtual void DeleteJoint(Joint* p) override { delete Cast::Up<MyJoint>(p); }
+	virtual Joint* CreateJoint() override { return m_PoolJoints.New(); }
+	virtual void DeleteJoint(Joint* p) override { m_PoolJoints.Delete(Cast::Up<MyJoint>(p)); }
+	virtual void OnCleared() override { m_PoolJoints.Release(); }
 
 	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&);
 
@@ -178,10 +254,15 @@ public:
 
 	~RadixHashOnlyTree() { Clear(); }
 
+	virtual void get_MemStats(SlabPool::Stats&) const override;
+
 protected:
-	virtual Leaf* CreateLeaf() override { return new MyLeaf; }
+	SlabPool_T<MyLeaf> m_PoolLeafs;
+
+	virtual Leaf* CreateLeaf() override { return m_PoolLeafs.New(); }
 	virtual uint8_t* GetLeafKey(const Leaf& x) const override { return Cast::Up<MyLeaf>(Cast::NotConst(x)).m_Hash.m_pData; }
-	virtual void DeleteLeaf(Leaf* p) override { delete Cast::Up<MyLeaf>(p); }
+	virtual void DeleteLeaf(Leaf* p) override { m_PoolLeafs.Delete(Cast::Up<MyLeaf>(p)); }
+	virtual void OnCleared() override;
 	virtual const Merkle::Hash& get_LeafHash(Node& n, Merkle::Hash&) override { return Cast::Up<MyLeaf>(n).m_Hash; }
 };
 
@@ -244,6 +325,8 @@ public:
 
 	~UtxoTree() { Clear(); }
 
+	virtual void get_MemStats(SlabPool::Stats&) const override;
+
     template<typename Archive>
     Archive& save(Archive& ar) const
 	{
@@ -281,9 +364,12 @@ public:
 	};
 
 protected:
-	virtual Leaf* CreateLeaf() override { return new MyLeaf; }
+	SlabPool_T<MyLeaf> m_PoolLeafs;
+
+	virtual Leaf* CreateLeaf() override { return m_PoolLeafs.New(); }
 	virtual uint8_t* GetLeafKey(const Leaf& x) const override { return Cast::Up<MyLeaf>(Cast::NotConst(x)).m_Key.V.m_pData; }
-	virtual void DeleteLeaf(Leaf* p) override { delete Cast::Up<MyLeaf>(p); }
+	virtual void DeleteLeaf(Leaf* p) override { m_PoolLeafs.Delete(Cast::Up<MyLeaf>(p)); }
+	virtual void OnCleared() override;
 	virtual const Merkle::Hash& get_LeafHash(Node&, Merkle::Hash&) override;
 
 	struct ISerializer {
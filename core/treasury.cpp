@@ -220,7 +220,7 @@ namespace grimm
 		pars.m_bVerifyOrder = false;
 		TxBase::Context ctx(pars);
 		ZeroObject(ctx.m_Height);
-		if (!ctx.ValidateAndSummarize(m_Base, Reader(*this)))
+		if (!ctx.ValidateAndSummarizeBatched(m_Base, Reader(*this)))
 			return false;
 
 		Point::Native comm, comm2;
@@ -401,7 +401,7 @@ namespace grimm
 		TxBase::Context::Params pars;
 		TxBase::Context ctx(pars);
 		ZeroObject(ctx.m_Height); // current height is zero
-		if (!ctx.ValidateAndSummarize(m_Data, m_Data.get_Reader()))
+		if (!ctx.ValidateAndSummarizeBatched(m_Data, m_Data.get_Reader()))
 			return false;
 
 		if (!(ctx.m_Fee == Zero))
@@ -19,6 +19,7 @@
 #include "../../utility/serialize.h"
 #include "../serialization_adapters.h"
 #include "../aes.h"
+#include "../cpu_features.h"
 #include "../proto.h"
 #include "../negotiator.h"
 
@@ -227,6 +228,63 @@ void TestHash()
 	}
 }
 
+void TestHashVectors()
+{
+	// SHA-256 and HMAC-SHA-256 (RFC 4231, case 2). Both with the SHA extensions (if present) and the portable code
+	const uint8_t pAbc[] = {
+		0xBA,0x78,0x16,0xBF,0x8F,0x01,0xCF,0xEA,0x41,0x41,0x40,0xDE,0x5D,0xAE,0x22,0x23,
+		0xB0,0x03,0x61,0xA3,0x96,0x17,0x7A,0x9C,0xB4,0x10,0xFF,0x61,0xF2,0x00,0x15,0xAD
+	};
+
+	const uint8_t pMillionA[] = {
+		0xCD,0xC7,0x6E,0x5C,0x99,0x14,0xFB,0x92,0x81,0xA1,0xC7,0xE2,0x84,0xD7,0x3E,0x67,
+		0xF1,0x80,0x9A,0x48,0xA4,0x97,0x20,0x0E,0x04,0x6D,0x39,0xCC,0xC7,0x11,0x2C,0xD0
+	};
+
+	const uint8_t pHMac[] = {
+		0x5B,0xDC,0xC1,0x46,0xBF,0x60,0x75,0x4E,0x6A,0x04,0x24,0x26,0x08,0x95,0x75,0xC7,
+		0x5A,0x00,0x3F,0x08,0x9D,0x27,0x39,0x83,0x9D,0xEC,0x58,0xB9,0x64,0xEC,0x38,0x43
+	};
+
+	grimm::CpuFeatures& cf = grimm::CpuFeatures::get();
+	const bool bSha = cf.m_Sha;
+
+	std::vector<uint8_t> vRand(0x1000);
+	GenerateRandom(&vRand.front(), static_cast<uint32_t>(vRand.size()));
+	Hash::Value pRand[2];
+
+	for (int iPass = 0; iPass < 2; iPass++)
+	{
+		cf.m_Sha = bSha && !iPass;
+
+		Hash::Value hv;
+		Hash::Processor() << grimm::Blob("abc", 3) >> hv;
+		verify_test(!memcmp(hv.m_pData, pAbc, sizeof(pAbc)));
+
+		// uneven chunks, to cover the partial block buffering
+		std::vector<uint8_t> vA(1000000, 'a');
+		Hash::Processor hp;
+		for (uint32_t nDone = 0, n = 1; nDone < vA.size(); nDone += n, n = (n * 7 + 5) % 300)
+		{
+			n = std::min(n, static_cast<uint32_t>(vA.size() - nDone));
+			hp << grimm::Blob(&vA.front() + nDone, n);
+		}
+		hp >> hv;
+		verify_test(!memcmp(hv.m_pData, pMillionA, sizeof(pMillionA)));
+
+		const char szMsg[] = "what do ya want for nothing?";
+		Hash::Mac hm("Jefe", 4);
+		hm.Write(szMsg, sizeof(szMsg) - 1);
+		hm >> hv;
+		verify_test(!memcmp(hv.m_pData, pHMac, sizeof(pHMac)));
+
+		Hash::Processor() << grimm::Blob(&vRand.front(), static_cast<uint32_t>(vRand.size())) >> pRand[iPass];
+	}
+
+	verify_test(pRand[0] == pRand[1]);
+	cf.m_Sha = bSha;
+}
+
 void TestScalars()
 {
 	Scalar::Native s0, s1, s2;
@@ -1262,6 +1320,21 @@ void TestTransaction()
 	ctx.m_Height.m_Min = g_hFork;
 	verify_test(tm.m_Trans.IsValid(ctx));
 	verify_test(ctx.m_Fee == grimm::AmountBig::Type(fee1 + fee2));
+
+	// kernel signatures are verified in a batch, a single bad one must fail it (and be pinned down by the per-element fallback)
+	ECC::Signature sig = tm.m_Trans.m_vKernels.front()->m_Signature;
+	tm.m_Trans.m_vKernels.front()->m_Signature.m_k.m_Value.Inc();
+
+	ctx.Reset();
+	ctx.m_Height.m_Min = g_hFork;
+	verify_test(!tm.m_Trans.IsValid(ctx));
+
+	// the batch is reused, the failure must not leak into the next validation
+	tm.m_Trans.m_vKernels.front()->m_Signature = sig;
+
+	ctx.Reset();
+	ctx.m_Height.m_Min = g_hFork;
+	verify_test(tm.m_Trans.IsValid(ctx));
 }
 
 
@@ -1339,6 +1412,71 @@ void TestAES()
 	verify_test(!memcmp(pBuf, pPlaintext, sizeof(pPlaintext)));
 }
 
+void TestAESCtr()
+{
+	// CTR-AES256: NIST SP 800-38A, F.5.5
+	const uint8_t pKey[AES::s_KeyBytes] = {
+		0x60,0x3D,0xEB,0x10,0x15,0xCA,0x71,0xBE,0x2B,0x73,0xAE,0xF0,0x85,0x7D,0x77,0x81,
+		0x1F,0x35,0x2C,0x07,0x3B,0x61,0x08,0xD7,0x2D,0x98,0x10,0xA3,0x09,0x14,0xDF,0xF4
+	};
+
+	const uint8_t pPlaintext[AES::s_BlockSize * 4] = {
+		0x6B,0xC1,0xBE,0xE2,0x2E,0x40,0x9F,0x96,0xE9,0x3D,0x7E,0x11,0x73,0x93,0x17,0x2A,
+		0xAE,0x2D,0x8A,0x57,0x1E,0x03,0xAC,0x9C,0x9E,0xB7,0x6F,0xAC,0x45,0xAF,0x8E,0x51,
+		0x30,0xC8,0x1C,0x46,0xA3,0x5C,0xE4,0x11,0xE5,0xFB,0xC1,0x19,0x1A,0x0A,0x52,0xEF,
+		0xF6,0x9F,0x24,0x45,0xDF,0x4F,0x9B,0x17,0xAD,0x2B,0x41,0x7B,0xE6,0x6C,0x37,0x10
+	};
+
+	const uint8_t pCiphertext[AES::s_BlockSize * 4] = {
+		0x60,0x1E,0xC3,0x13,0x77,0x57,0x89,0xA5,0xB7,0xA7,0xF5,0x04,0xBB,0xF3,0xD2,0x28,
+		0xF4,0x43,0xE3,0xCA,0x4D,0x62,0xB5,0x9A,0xCA,0x84,0xE9,0x90,0xCA,0xCA,0xF5,0xC5,
+		0x2B,0x09,0x30,0xDA,0xA2,0x3D,0xE9,0x4C,0xE8,0x70,0x17,0xBA,0x2D,0x84,0x98,0x8D,
+		0xDF,0xC9,0xC5,0x8D,0xB6,0x7A,0xAD,0xA6,0x13,0xC2,0xDD,0x08,0x45,0x79,0x41,0xA6
+	};
+
+	AES::Encoder enc;
+	enc.Init(pKey);
+
+	grimm::CpuFeatures& cf = grimm::CpuFeatures::get();
+	const bool bAes = cf.m_Aes;
+
+	std::vector<uint8_t> pStream[2];
+
+	for (int iPass = 0; iPass < 2; iPass++)
+	{
+		cf.m_Aes = bAes && !iPass;
+
+		// different splits, including partial blocks
+		for (uint32_t nSplit = 1; nSplit <= sizeof(pPlaintext); nSplit += 5)
+		{
+			AES::StreamCipher asc;
+			asc.Reset();
+			for (uint32_t i = 0; i < AES::s_BlockSize; i++)
+				asc.m_Counter.m_pData[i] = static_cast<uint8_t>(0xF0 + i);
+
+			uint8_t pBuf[sizeof(pPlaintext)];
+			memcpy(pBuf, pPlaintext, sizeof(pBuf));
+
+			for (uint32_t nDone = 0; nDone < sizeof(pBuf); nDone += nSplit)
+				asc.XCrypt(enc, pBuf + nDone, std::min(nSplit, static_cast<uint32_t>(sizeof(pBuf)) - nDone));
+
+			verify_test(!memcmp(pBuf, pCiphertext, sizeof(pBuf)));
+		}
+
+		// long keystream, over the counter carry
+		AES::StreamCipher asc;
+		asc.Reset();
+		memset(asc.m_Counter.m_pData + AES::s_BlockSize - 2, 0xff, 2);
+
+		pStream[iPass].assign(0x10000 + 7, 0);
+		asc.XCrypt(enc, &pStream[iPass].front(), 3);
+		asc.XCrypt(enc, &pStream[iPass].front() + 3, static_cast<uint32_t>(pStream[iPass].size() - 3));
+	}
+
+	verify_test(pStream[0] == pStream[1]);
+	cf.m_Aes = bAes;
+}
+
 void TestKdf()
 {
 	HKdf skdf;
@@ -1659,6 +1797,7 @@ void TestAll()
 {
 	TestUintBig();
 	TestHash();
+	TestHashVectors();
 	TestScalars();
 	TestPoints();
 	TestSigning();
@@ -1669,6 +1808,7 @@ void TestAll()
 	TestMultiSigOutput();
 	TestCutThrough();
 	TestAES();
+	TestAESCtr();
 	TestKdf();
 	TestBbs();
 	TestDifficulty();
@@ -2110,27 +2250,56 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	grimm::CpuFeatures& cf = grimm::CpuFeatures::get();
+	const grimm::CpuFeatures cfDetected = cf;
+
+	for (int iPass = 0; iPass < 2; iPass++)
 	{
+		// hw-accelerated (if supported), then portable
+		cf.m_Aes = cfDetected.m_Aes && !iPass;
+		cf.m_Sha = cfDetected.m_Sha && !iPass;
+
 		AES::Encoder enc;
 		enc.Init(hv.m_pData);
 		AES::StreamCipher asc;
 		asc.Reset();
 
 		uint8_t pBuf[0x400];
+		memset(pBuf, 0, sizeof(pBuf));
 
-		BenchmarkMeter bm("AES.XCrypt-1MB");
-		bm.N = 10;
-		do
 		{
-			for (uint32_t i = 0; i < bm.N; i++)
+			BenchmarkMeter bm(cf.m_Aes ? "AES.XCrypt-1MB.NI" : "AES.XCrypt-1MB");
+			bm.N = 10;
+			do
 			{
-				for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
-					asc.XCrypt(enc, pBuf, sizeof(pBuf));
-			}
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
+						asc.XCrypt(enc, pBuf, sizeof(pBuf));
+				}
 
-		} while (bm.ShouldContinue());
+			} while (bm.ShouldContinue());
+		}
+
+		{
+			BenchmarkMeter bm(cf.m_Sha ? "HMac-1MB.SHA-NI" : "HMac-1MB");
+			bm.N = 10;
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					Hash::Mac hm(hv.m_pData, hv.nBytes);
+					for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
+						hm.Write(pBuf, sizeof(pBuf));
+					hm >> hv;
+				}
+
+			} while (bm.ShouldContinue());
+		}
 	}
 
+	cf = cfDetected;
+
 	{
 		uint8_t pBuf[0x400];
 
@@ -295,6 +295,12 @@ namespace grimm
 
 		t.get_Hash(hv1);
 
+		RadixTree::SlabPool::Stats st;
+		ZeroObject(st);
+		t.get_MemStats(st);
+		verify_test(st.m_Nodes == vKeys.size() * 2 - 1); // leafs + joints
+		verify_test(st.m_Slabs && (st.m_Bytes > st.m_Nodes * sizeof(UtxoTree::MyJoint)));
+
 		for (uint32_t i = 0; i < vKeys.size(); i++)
 		{
 			if (i == vKeys.size()/2)
@@ -316,6 +322,12 @@ namespace grimm
 		t.get_Hash(hv2);
 		verify_test(hv2 == Zero);
 
+		// the slabs are retained for reuse
+		size_t nSlabs = st.m_Slabs;
+		ZeroObject(st);
+		t.get_MemStats(st);
+		verify_test(!st.m_Nodes && (st.m_Slabs == nSlabs));
+
 		// construct tree in different order
 		for (uint32_t i = (uint32_t) vKeys.size(); i--; )
 		{
@@ -343,6 +355,10 @@ namespace grimm
 
 		verify_test(vKeys.size() == t.Count());
 
+		ZeroObject(st);
+		t.get_MemStats(st);
+		verify_test(st.m_Slabs == nSlabs);
+
 		// serialization
 		Serializer ser;
 		t.save(ser);
@@ -354,6 +370,14 @@ namespace grimm
 
 		t.load(der);
 
+		// hash the subtrees independently (in reverse order), then the top
+		UtxoTree::Subtrees sts;
+		sts.Collect(t, 4);
+		verify_test(sts.m_v.size() > 1);
+
+		for (size_t i = sts.m_v.size(); i--; )
+			sts.Hash(t, i);
+
 		t.get_Hash(hv2);
 		verify_test(hv2 == hv1);
 
@@ -20,6 +20,8 @@
 #include "nlohmann/json.hpp"
 #include "utility/helpers.h"
 #include "utility/logger.h"
+#include "utility/io/asyncevent.h"
+#include <mutex>
 
 namespace grimm { namespace explorer {
 
@@ -112,6 +114,11 @@ public:
 
     virtual ~Adapter() {
         if (_nextHook) *_hook = _nextHook;
+
+        if (_readQueue) {
+            std::unique_lock<std::mutex> scope(_readQueue->mutex);
+            _readQueue->evtDone.reset();
+        }
     }
 
 private:
@@ -155,6 +162,7 @@ private:
         auto& blocks = _cache.blocks;
 
         blocks.erase(blocks.lower_bound(id.m_Height), blocks.end());
+        _rollbacks++; // results of the pending reads may be outdated
 
         if (_nextHook) _nextHook->OnRolledBack(id);
     }
@@ -192,8 +200,7 @@ private:
         return true;
     }
 
-    bool extract_row(Height height, uint64_t& row, uint64_t* prevRow) {
-        NodeDB& db = _nodeBackend.get_DB();
+    static bool extract_row(NodeDB& db, Height height, uint64_t& row, uint64_t* prevRow) {
         NodeDB::WalkerState ws(db);
         db.EnumStatesAt(ws, height);
         while (true) {
@@ -214,9 +221,7 @@ private:
         return true;
     }
 
-    bool extract_block_from_row(json& out, uint64_t row) {
-        NodeDB& db = _nodeBackend.get_DB();
-
+    static bool extract_block_from_row(NodeProcessor& np, NodeDB& db, json& out, uint64_t row) {
         Block::SystemState::Full blockState;
 		Block::SystemState::ID id;
 		Block::Body block;
@@ -229,7 +234,7 @@ private:
 			NodeDB::StateID sid;
 			sid.m_Row = row;
 			sid.m_Height = id.m_Height;
-			_nodeBackend.ExtractBlockWithExtra(block, sid);
+			np.ExtractBlockWithExtra(db, block, sid);
 
 		} catch (...) {
             ok = false;
@@ -298,20 +303,20 @@ private:
     bool extract_block(json& out, Height height, uint64_t& row, uint64_t* prevRow) {
         bool ok = true;
         if (row == 0) {
-            ok = extract_row(height, row, prevRow);
+            ok = extract_row(_nodeBackend.get_DB(), height, row, prevRow);
         } else if (prevRow != 0) {
             *prevRow = row;
             if (!_nodeBackend.get_DB().get_Prev(*prevRow)) {
                 *prevRow = 0;
             }
         }
-        return ok && extract_block_from_row(out, row);
+        return ok && extract_block_from_row(_nodeBackend, _nodeBackend.get_DB(), out, row);
     }
 
     bool get_block_impl(io::SerializedMsg& out, uint64_t height, uint64_t& row, uint64_t* prevRow) {
         if (_cache.get_block(out, height)) {
             if (prevRow && row > 0) {
-                extract_row(height, row, prevRow);
+                extract_row(_nodeBackend.get_DB(), height, row, prevRow);
             }
             return true;
         }
@@ -371,6 +376,149 @@ private:
         return get_block_impl(out, height, row, 0);
     }
 
+    struct BlockResult {
+        uint64_t id;
+        uint64_t rollbacks;
+        Height height;
+        bool found;
+        bool ok;
+        io::SharedBuffer body;
+    };
+
+    struct ReadQueue {
+        std::mutex mutex;
+        std::deque<BlockResult> done;
+        io::AsyncEvent::Ptr evtDone; // reset when the adapter is destroyed
+    };
+
+    /// Executed by the node DB reader against the last committed state
+    struct BlockJob : public NodeProcessor::ReadJob {
+        std::shared_ptr<ReadQueue> queue;
+        NodeProcessor* backend;
+        BlockBy by;
+        ByteBuffer key;
+        Height currentHeight;
+        BlockResult res;
+
+        void Exec(NodeDB& db) override {
+            res.found = false;
+            res.ok = false;
+
+            try {
+                if (BlockBy::hash == by) {
+                    res.height = db.FindBlock(key);
+                } else if (BlockBy::kernel == by) {
+                    res.height = db.FindKernel(key);
+                }
+
+                json j;
+                uint64_t row = 0;
+                res.found =
+                    (res.height <= currentHeight) &&
+                    extract_row(db, res.height, row, 0) &&
+                    extract_block_from_row(*backend, db, j, row);
+
+                if (!res.found) {
+                    j = json{ { "found", false}, {"height", res.height } };
+                }
+
+                HttpMsgCreator packer(PACKER_FRAGMENTS_SIZE);
+                io::SerializedMsg sm;
+                res.ok = serialize_json_msg(sm, packer, j);
+                if (res.ok) {
+                    res.body = io::normalize(sm, true);
+                }
+            } catch (const NodeDBSegmentGoneException&) {
+                throw; // re-run by the reader with a newer snapshot, or OnFailed() if it gives up
+            } catch (const std::exception& e) {
+                LOG_ERROR() << "explorer block read failed: " << e.what();
+            }
+
+            push_result();
+        }
+
+        void OnFailed() override {
+            res.found = false;
+            res.ok = false;
+            push_result();
+        }
+
+        void push_result() {
+            std::unique_lock<std::mutex> scope(queue->mutex);
+            queue->done.push_back(std::move(res));
+            if (queue->evtDone) {
+                queue->evtDone->post();
+            }
+        }
+    };
+
+    bool get_block_async(BlockBy by, uint64_t height, const ByteBuffer& key, BlockCallback&& callback) override {
+        if (BlockBy::height == by && _cache.blocks.count(height)) {
+            return false; // cached
+        }
+
+        if (_statusDirty) {
+            const auto &cursor = _nodeBackend.m_Cursor;
+            _cache.currentHeight = cursor.m_Sid.m_Height;
+            _cache.lowHorizon = _nodeBackend.m_Extra.m_LoHorizon;
+        }
+
+        if (!_readQueue) {
+            _readQueue = std::make_shared<ReadQueue>();
+            _readQueue->evtDone = io::AsyncEvent::create(io::Reactor::get_Current(), [this]() { on_blocks_read(); });
+        }
+
+        std::unique_ptr<BlockJob> pJob(new BlockJob);
+        pJob->queue = _readQueue;
+        pJob->backend = &_nodeBackend;
+        pJob->by = by;
+        pJob->key = key;
+        pJob->currentHeight = _cache.currentHeight;
+        pJob->res.id = ++_lastReadId;
+        pJob->res.rollbacks = _rollbacks;
+        pJob->res.height = height;
+
+        NodeProcessor::ReadJob::Ptr pReadJob(std::move(pJob));
+        if (!_nodeBackend.PostRead(pReadJob)) {
+            return false;
+        }
+
+        _pendingReads[_lastReadId] = std::move(callback);
+        return true;
+    }
+
+    void on_blocks_read() {
+        while (true) {
+            BlockResult res;
+            {
+                std::unique_lock<std::mutex> scope(_readQueue->mutex);
+                if (_readQueue->done.empty()) {
+                    break;
+                }
+                res = std::move(_readQueue->done.front());
+                _readQueue->done.pop_front();
+            }
+
+            auto it = _pendingReads.find(res.id);
+            if (it == _pendingReads.end()) {
+                continue;
+            }
+
+            BlockCallback callback = std::move(it->second);
+            _pendingReads.erase(it);
+
+            if (res.ok && res.found && (res.rollbacks == _rollbacks)) {
+                _cache.put_block(res.height, res.body);
+            }
+
+            io::SerializedMsg out;
+            if (res.ok) {
+                out.push_back(res.body);
+            }
+            callback(res.ok, out);
+        }
+    }
+
     bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) override {
         static const uint64_t maxElements = 1500;
         if (n > maxElements) n = maxElements;
@@ -443,6 +591,12 @@ private:
     ResponseCache _cache;
 
     io::SerializedMsg _sm;
+
+    // blocks being read by the node DB readers
+    std::shared_ptr<ReadQueue> _readQueue;
+    std::map<uint64_t, BlockCallback> _pendingReads;
+    uint64_t _lastReadId = 0;
+    uint64_t _rollbacks = 0;
 };
 
 IAdapter::Ptr create_adapter(Node& node) {
@@ -14,6 +14,7 @@
 
 #include "utility/io/buffer.h"
 #include "utility/common.h"
+#include <functional>
 
 namespace grimm {
 
@@ -36,6 +37,13 @@ struct IAdapter {
 
     virtual bool get_block_by_kernel(io::SerializedMsg& out, const ByteBuffer& key) = 0;
 
+    enum class BlockBy { height, hash, kernel };
+    using BlockCallback = std::function<void(bool ok, io::SerializedMsg& body)>;
+
+    /// Looks up the block in a DB reader thread of the node, the callback is invoked later in the reactor thread.
+    /// Returns false if the request can't be posted, the synchronous get_block* should be used then
+    virtual bool get_block_async(BlockBy by, uint64_t height, const ByteBuffer& key, BlockCallback&& callback) = 0;
+
     virtual bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) = 0;
 
     virtual bool get_peers(io::SerializedMsg& out) = 0;
@@ -208,6 +208,7 @@ void setup_node(Node& node, const Options& o) {
     node.m_Cfg.m_Listen.ip(o.nodeListenTo.ip());
     node.m_Cfg.m_MiningThreads = 0;
     node.m_Cfg.m_VerificationThreads = 1;
+    node.m_Cfg.m_ProcessorParams.m_ReadThreads = 2; // block requests are served by the DB readers, concurrently with the sync
 
     node.m_Keys.m_pOwner = o.ownerKey;
 
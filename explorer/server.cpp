@@ -106,6 +106,16 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
     if (msg.what != HttpMsgReader::http_message || !msg.msg) {
         LOG_DEBUG() << STS << "-peer " << io::Address::from_u64(id) << " : " << msg.error_str();
         _connections.erase(id);
+        _pending.erase(id);
+        return false;
+    }
+
+    if (_pending.count(id)) {
+        // pipelined request while the previous one is still being read. The responses would be reordered
+        LOG_DEBUG() << STS << "-peer " << io::Address::from_u64(id) << " : pipelined request";
+        it->second->shutdown();
+        _connections.erase(it);
+        _pending.erase(id);
         return false;
     }
 
@@ -167,8 +177,51 @@ bool Server::send_status(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
+bool Server::post_block(const HttpConnection::Ptr& conn) {
+    IAdapter::BlockBy by = IAdapter::BlockBy::height;
+    ByteBuffer key;
+    uint64_t height = 0;
+
+    if (_currentUrl.has_arg("hash")) {
+        if (!_currentUrl.get_hex_arg("hash", key)) return false;
+        by = IAdapter::BlockBy::hash;
+    } else if (_currentUrl.has_arg("kernel")) {
+        if (!_currentUrl.get_hex_arg("kernel", key)) return false;
+        by = IAdapter::BlockBy::kernel;
+    } else {
+        height = _currentUrl.get_int_arg("height", 0);
+    }
+
+    uint64_t id = conn->id();
+    if (!_backend.get_block_async(by, height, key, [this, id](bool ok, io::SerializedMsg& body) { on_block_read(id, ok, body); })) {
+        return false;
+    }
+
+    _pending.insert(id);
+    return true;
+}
+
+void Server::on_block_read(uint64_t id, bool ok, io::SerializedMsg& body) {
+    if (!_pending.erase(id)) return;
+
+    auto it = _connections.find(id);
+    if (it == _connections.end()) return;
+
+    _body.swap(body);
+    bool keepalive = ok ? send(it->second, 200, "OK") : send(it->second, 500, "Internal error #2");
+
+    if (!keepalive) {
+        it->second->shutdown();
+        _connections.erase(it);
+    }
+}
+
 bool Server::send_block(const HttpConnection::Ptr &conn) {
 
+    if (post_block(conn)) {
+        return true; // will be sent once read
+    }
+
     if (_currentUrl.has_arg("hash"))
     {
         ByteBuffer hash;
@@ -51,6 +51,8 @@ private:
     bool on_request(uint64_t id, const HttpMsgReader::Message& msg);
     bool send_status(const HttpConnection::Ptr& conn);
     bool send_block(const HttpConnection::Ptr& conn);
+    bool post_block(const HttpConnection::Ptr& conn);
+    void on_block_read(uint64_t id, bool ok, io::SerializedMsg& body);
     bool send_blocks(const HttpConnection::Ptr& conn);
     bool send_peers(const HttpConnection::Ptr& conn);
     bool send(const HttpConnection::Ptr& conn, int code, const char* message);
@@ -62,6 +64,7 @@ private:
     io::Address _bindAddress;
     io::TcpServer::Ptr _server;
     std::map<uint64_t, HttpConnection::Ptr> _connections;
+    std::set<uint64_t> _pending; // connections with requests being read asynchronously
     HttpUrl _currentUrl;
     io::SerializedMsg _headers;
     io::SerializedMsg _body;
@@ -234,6 +234,8 @@ int main_impl(int argc, char* argv[])
 
 					node.m_Cfg.m_VerificationThreads = vm[cli::VERIFICATION_THREADS].as<int>();
 
+					node.m_Cfg.m_IoThreads = vm[cli::IO_THREADS].as<uint32_t>();
+
 					node.m_Cfg.m_LogUtxos = vm[cli::LOG_UTXOS].as<bool>();
 
 					std::string sKeyOwner;
@@ -319,6 +321,12 @@ int main_impl(int argc, char* argv[])
 					if (vm.count(cli::CHECKDB))
 						node.m_Cfg.m_ProcessorParams.m_CheckIntegrityAndVacuum = vm[cli::CHECKDB].as<bool>();
 
+					if (vm.count(cli::UTXO_SNAPSHOT))
+						node.m_Cfg.m_ProcessorParams.m_UtxoSnapshot = vm[cli::UTXO_SNAPSHOT].as<bool>();
+
+					if (vm.count(cli::LAZY_COMMIT))
+						node.m_Cfg.m_ProcessorParams.m_LazyCommit = vm[cli::LAZY_COMMIT].as<bool>();
+
 					if (vm.count(cli::RESET_ID))
 						node.m_Cfg.m_ProcessorParams.m_ResetSelfID = vm[cli::RESET_ID].as<bool>();
 
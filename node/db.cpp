@@ -13,6 +13,19 @@
 // limitations under the License.
 
 #include "db.h"
+#include <set>
+#include <atomic>
+#include <boost/intrusive/set.hpp>
+#include <boost/intrusive/list.hpp>
+
+#ifndef WIN32
+#	include <errno.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/types.h>
+#	include <unistd.h>
+#endif // WIN32
 
 namespace grimm {
 
@@ -81,6 +94,21 @@ namespace grimm {
 #define TblTxo_Value			"Value"
 #define TblTxo_SpendHeight		"SpendHeight"
 
+#define TblBodies				"Bodies"
+#define TblBodies_State			"State"
+#define TblBodies_SegP			"SegP"
+#define TblBodies_OffsetP		"OffsetP"
+#define TblBodies_SizeP			"SizeP"
+#define TblBodies_SegE			"SegE"
+#define TblBodies_OffsetE		"OffsetE"
+#define TblBodies_SizeE			"SizeE"
+
+#define TblTxoProofs			"TxoProofs"
+#define TblTxoProofs_ID			"ID"
+#define TblTxoProofs_Seg		"Seg"
+#define TblTxoProofs_Offset		"Offset"
+#define TblTxoProofs_Size		"Size"
+
 NodeDB::NodeDB()
 	:m_pDb(NULL)
 {
@@ -134,6 +162,12 @@ void NodeDB::Close()
 		for (size_t i = 0; i < _countof(m_pPrep); i++)
 			m_pPrep[i].Close();
 
+		for (size_t i = 0; i < _countof(m_ppBodies); i++)
+			m_ppBodies[i].reset();
+
+		m_pKrnCache.reset();
+		m_bKrnCache = false;
+
         GRIMM_VERIFY(SQLITE_OK == sqlite3_close(m_pDb));
 		m_pDb = NULL;
 	}
@@ -264,13 +298,51 @@ const void* NodeDB::Recordset::get_BlobStrict(int col, uint32_t n)
 	return x.p;
 }
 
-void NodeDB::Open(const char* szPath)
+void NodeDB::Open(const char* szPath, OpenMode::Enum eMode /* = OpenMode::Exclusive */)
 {
-	TestRet(sqlite3_open_v2(szPath, &m_pDb, SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX | SQLITE_OPEN_CREATE, NULL));
+	bool bReadOnly = (OpenMode::ReadOnly == eMode);
+	int nFlags =
+		bReadOnly ? SQLITE_OPEN_READONLY :
+		(OpenMode::Checkpoint == eMode) ? SQLITE_OPEN_READWRITE :
+		(SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+
+	TestRet(sqlite3_open_v2(szPath, &m_pDb, nFlags | SQLITE_OPEN_NOMUTEX, NULL));
 	// Attempt to fix the "busy" error when PC goes to sleep and then awakes. Try the busy handler with non-zero timeout (maybe a single retry would be enough)
 	sqlite3_busy_timeout(m_pDb, 5000);
 
-	ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+	if (OpenMode::Checkpoint == eMode)
+	{
+		// no DB access, the writer holds the tx open most of the time. Only read the header, otherwise the WAL isn't recognized
+		ExecQuick("PRAGMA journal_mode");
+		return;
+	}
+
+	const uint64_t nVersionBottom = 17; // older versions can't be upgraded
+	const uint64_t nVersionTop = 19;
+
+	if (bReadOnly)
+	{
+		if (ParamIntGetDef(ParamID::DbVer) != nVersionTop)
+			ThrowError("DB version mismatch");
+
+		OpenBodies(szPath, true);
+		return;
+	}
+
+	m_bKrnCache = true;
+
+	if ((OpenMode::Wal == eMode) || (OpenMode::WalLazy == eMode))
+		ExecTextOut("PRAGMA journal_mode = WAL"); // readers don't block the writer, and see the last committed state
+	else
+		ExecTextOut("PRAGMA locking_mode = EXCLUSIVE");
+
+	if (OpenMode::WalLazy == eMode)
+	{
+		// neither commits nor checkpoints fsync on this handle. Checkpoints are done by the Checkpoint handle, which syncs the WAL
+		ExecQuick("PRAGMA synchronous = NORMAL");
+		ExecQuick("PRAGMA wal_autocheckpoint = 0");
+	}
+
 	ExecTextOut("PRAGMA journal_size_limit=1048576"); // limit journal file, otherwise it may remain huge even after tx commit, until the app is closed
 
 	bool bCreate;
@@ -280,10 +352,9 @@ void NodeDB::Open(const char* szPath)
 		bCreate = !rs.Step();
 	}
 
-	const uint64_t nVersionTop = 17;
-
 	Transaction t(*this);
 
+	uint64_t nVer = nVersionTop;
 	if (bCreate)
 	{
 		Create();
@@ -291,14 +362,65 @@ void NodeDB::Open(const char* szPath)
 	}
 	else
 	{
-		uint64_t nVer = ParamIntGetDef(ParamID::DbVer);
-		if (nVer < nVersionTop)
+		nVer = ParamIntGetDef(ParamID::DbVer);
+		if (nVer < nVersionBottom)
 			throw NodeDBUpgradeException("Node upgrade is not supported. Please, remove node.db and tempmb files");
+		if (nVer > nVersionTop)
+			throw NodeDBUpgradeException("Node downgrade is not supported. The DB was created by a newer version");
+
+		if (nVer < 18)
+			CreateTableBodies();
 	}
 
+	if (nVer < 19)
+	{
+		// the full values that are still in the Txo table are moved to the side log by the processor, it knows how to strip them
+		CreateTableTxoProofs();
+
+		uint64_t nUpgrade = 1;
+		ParamSet(ParamID::TxoProofsUpgrade, &nUpgrade, NULL);
+	}
+
+	OpenBodies(szPath, false);
+
+	if (nVer < 18)
+		MigrateBodies();
+
+	if (nVer != nVersionTop)
+		ParamSet(ParamID::DbVer, &nVersionTop, NULL);
+
 	t.Commit();
 }
 
+void NodeDB::MigrateBodies()
+{
+	// Before the version 18 the bodies were kept in the States table
+	{
+		Recordset rs(*this, Query::StateGetBlock, "SELECT rowid," TblStates_BodyP "," TblStates_BodyE " FROM " TblStates
+			" WHERE " TblStates_BodyP " IS NOT NULL OR " TblStates_BodyE " IS NOT NULL");
+
+		while (rs.Step())
+		{
+			uint64_t rowid;
+			rs.get(0, rowid);
+
+			Blob pBody[2];
+			for (int i = 0; i < 2; i++)
+			{
+				if (rs.IsNull(i + 1))
+					pBody[i] = Blob(NULL, 0);
+				else
+					rs.get(i + 1, pBody[i]);
+			}
+
+			PutBodies(rowid, pBody);
+		}
+	}
+
+	Recordset rs(*this, Query::StateSetBlock, "UPDATE " TblStates " SET " TblStates_BodyP "=NULL," TblStates_BodyE "=NULL");
+	rs.Step();
+}
+
 void NodeDB::CheckIntegrity()
 {
 	std::string s = ExecTextOut("PRAGMA integrity_check");
@@ -308,6 +430,8 @@ void NodeDB::CheckIntegrity()
 
 void NodeDB::Create()
 {
+	ExecQuick("PRAGMA auto_vacuum = INCREMENTAL"); // must precede the tables creation
+
 	// create tables
 #define TblPrefix_Any(name) "CREATE TABLE [" #name "] ("
 
@@ -390,6 +514,8 @@ void NodeDB::Create()
 
 	CreateTableDummy();
 	CreateTableTxos();
+	CreateTableBodies();
+	CreateTableTxoProofs();
 }
 
 void NodeDB::CreateTableDummy()
@@ -411,11 +537,70 @@ void NodeDB::CreateTableTxos()
 	ExecQuick("CREATE INDEX [Idx" TblTxo "SH] ON [" TblTxo "] ([" TblTxo_SpendHeight "])");
 }
 
+void NodeDB::CreateTableBodies()
+{
+	ExecQuick("CREATE TABLE IF NOT EXISTS [" TblBodies "] ("
+		"[" TblBodies_State		"] INTEGER NOT NULL PRIMARY KEY,"
+		"[" TblBodies_SegP		"] INTEGER,"
+		"[" TblBodies_OffsetP	"] INTEGER,"
+		"[" TblBodies_SizeP		"] INTEGER,"
+		"[" TblBodies_SegE		"] INTEGER,"
+		"[" TblBodies_OffsetE	"] INTEGER,"
+		"[" TblBodies_SizeE		"] INTEGER,"
+		"FOREIGN KEY (" TblBodies_State ") REFERENCES " TblStates "(OID))");
+
+	ExecQuick("CREATE INDEX IF NOT EXISTS [Idx" TblBodies "P] ON [" TblBodies "] ([" TblBodies_SegP "])");
+	ExecQuick("CREATE INDEX IF NOT EXISTS [Idx" TblBodies "E] ON [" TblBodies "] ([" TblBodies_SegE "])");
+}
+
+void NodeDB::CreateTableTxoProofs()
+{
+	ExecQuick("CREATE TABLE IF NOT EXISTS [" TblTxoProofs "] ("
+		"[" TblTxoProofs_ID			"] INTEGER NOT NULL PRIMARY KEY,"
+		"[" TblTxoProofs_Seg		"] INTEGER NOT NULL,"
+		"[" TblTxoProofs_Offset		"] INTEGER NOT NULL,"
+		"[" TblTxoProofs_Size		"] INTEGER NOT NULL)");
+
+	ExecQuick("CREATE INDEX IF NOT EXISTS [Idx" TblTxoProofs "Seg] ON [" TblTxoProofs "] ([" TblTxoProofs_Seg "])");
+}
+
 void NodeDB::Vacuum()
 {
+	ExecQuick("PRAGMA auto_vacuum = INCREMENTAL"); // applied by the VACUUM for the DBs created before
 	ExecQuick("VACUUM");
 }
 
+bool NodeDB::IsIncrementalVacuum()
+{
+	Recordset rs(*this, Query::AutoVacuumGet, "PRAGMA auto_vacuum");
+	rs.StepStrict();
+
+	uint32_t nMode;
+	rs.get(0, nMode);
+	return (2 == nMode);
+}
+
+uint64_t NodeDB::get_FreePages()
+{
+	Recordset rs(*this, Query::FreePages, "PRAGMA freelist_count");
+	rs.StepStrict();
+
+	uint64_t nPages;
+	rs.get(0, nPages);
+	return nPages;
+}
+
+void NodeDB::VacuumStep()
+{
+	static_assert(256 == s_VacuumStepPages, "");
+
+	Recordset rs(*this, Query::VacuumStep, "PRAGMA incremental_vacuum(256)");
+	while (rs.Step())
+		;
+
+	OnModified();
+}
+
 void NodeDB::ExecQuick(const char* szSql)
 {
 	int n = sqlite3_total_changes(m_pDb);
@@ -605,7 +790,10 @@ void NodeDB::Transaction::Start(NodeDB& db)
 void NodeDB::Transaction::Commit()
 {
 	assert(m_pDB);
+	m_pDB->TxoFlushProofs();
+	m_pDB->SyncBodies(); // the index must never point to the data that isn't on disk
 	m_pDB->ExecStep(Query::Commit, "COMMIT");
+	m_pDB->OnBodiesCommitted(true);
 	m_pDB = NULL;
 }
 
@@ -614,6 +802,10 @@ void NodeDB::Transaction::Rollback()
 	if (m_pDB)
 	{
 		m_pDB->ExecStep(Query::Rollback, "ROLLBACK");
+		m_pDB->OnBodiesCommitted(false);
+		m_pDB->m_pKrnCache.reset();
+		m_pDB->m_bufTxoProofs.clear();
+		m_pDB->m_vTxoProofs.clear();
 		m_pDB = nullptr;
 	}
 }
@@ -814,6 +1006,9 @@ bool NodeDB::DeleteState(uint64_t rowid, uint64_t& rowPrev)
 	if (StateFlags::Reachable & nFlags)
 		TipReachableDel(rowid);
 
+	Blob pBody[2] = { Blob(NULL, 0), Blob(NULL, 0) };
+	PutBodies(rowid, pBody);
+
 	rs.Reset(Query::StateDel, "DELETE FROM " TblStates " WHERE rowid=?");
 	rs.put(0, rowid);
 
@@ -1148,37 +1343,530 @@ TxoID NodeDB::FindStateByTxoID(StateID& sid, TxoID id0)
 	return id0;
 }
 
-void NodeDB::SetStateBlock(uint64_t rowid, const Blob& bodyP, const Blob& bodyE)
+struct NodeDB::BodyStore
 {
-	Recordset rs(*this, Query::StateSetBlock, "UPDATE " TblStates " SET " TblStates_BodyP "=?," TblStates_BodyE "=? WHERE rowid=?");
-	if (bodyP.n)
-		rs.put(0, bodyP);
-	if (bodyE.n)
-		rs.put(1, bodyE);
-	rs.put(2, rowid);
+	// Bodies are appended to the active segment. Once a segment is no longer referenced by the index - it's deleted as a whole
+	static const uint64_t s_SegmentSize = uint64_t(1) << 27;
+
+	static void TestSysRet(bool bFail, const char* sz)
+	{
+		if (bFail)
+		{
+#ifdef WIN32
+			int nErrorCode = GetLastError();
+#else // WIN32
+			int nErrorCode = errno;
+#endif // WIN32
+
+			char szErr[0x100];
+			snprintf(szErr, _countof(szErr), "body store error=%d (%s)", nErrorCode, sz);
+			ThrowError(szErr);
+		}
+	}
+
+	struct Segment
+	{
+#ifdef WIN32
+		HANDLE m_hFile = INVALID_HANDLE_VALUE; // no mapping, the file grows. Read directly
+#else // WIN32
+		int m_hFile = -1;
+		const uint8_t* m_pMapping = nullptr; // reserved for the whole segment size, only the written part is accessed
+#endif // WIN32
+		uint64_t m_nSize = 0;
+		bool m_bDirty = false;
+
+		~Segment()
+		{
+#ifdef WIN32
+			if (INVALID_HANDLE_VALUE != m_hFile)
+				GRIMM_VERIFY(CloseHandle(m_hFile));
+#else // WIN32
+			if (m_pMapping)
+				GRIMM_VERIFY(!munmap((void*) m_pMapping, s_SegmentSize));
+			if (-1 != m_hFile)
+				GRIMM_VERIFY(!close(m_hFile));
+#endif // WIN32
+		}
+
+		void Open(const char* szPath, bool bReadOnly)
+		{
+#ifdef WIN32
+			m_hFile = bReadOnly ?
+				CreateFileA(szPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL) :
+				CreateFileA(szPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, 0, NULL);
+			if (bReadOnly && (INVALID_HANDLE_VALUE == m_hFile) && (ERROR_FILE_NOT_FOUND == GetLastError()))
+				throw NodeDBSegmentGoneException(szPath);
+			TestSysRet(INVALID_HANDLE_VALUE == m_hFile, "CreateFile");
+#else // WIN32
+			m_hFile = bReadOnly ?
+				open(szPath, O_RDONLY) :
+				open(szPath, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+			if (bReadOnly && (-1 == m_hFile) && (ENOENT == errno))
+				throw NodeDBSegmentGoneException(szPath);
+			TestSysRet(-1 == m_hFile, "open");
+#endif // WIN32
+
+			UpdateSize();
+
+#ifndef WIN32
+			void* pPtr = mmap(NULL, s_SegmentSize, PROT_READ, MAP_SHARED, m_hFile, 0);
+			if (MAP_FAILED != pPtr)
+				m_pMapping = (const uint8_t*) pPtr; // otherwise fall back to reads
+#endif // WIN32
+		}
+
+		void UpdateSize()
+		{
+#ifdef WIN32
+			TestSysRet(!GetFileSizeEx(m_hFile, (LARGE_INTEGER*) &m_nSize), "GetFileSizeEx");
+#else // WIN32
+			struct stat stats;
+			TestSysRet(fstat(m_hFile, &stats) != 0, "fstat");
+			m_nSize = stats.st_size;
+#endif // WIN32
+		}
+
+		void Write(const uint8_t* p, uint32_t n)
+		{
+			while (n)
+			{
+#ifdef WIN32
+				OVERLAPPED ov;
+				ZeroObject(ov);
+				ov.Offset = (DWORD) m_nSize;
+				ov.OffsetHigh = (DWORD) (m_nSize >> 32);
+
+				DWORD nDone = 0;
+				TestSysRet(!WriteFile(m_hFile, p, n, &nDone, &ov), "WriteFile");
+#else // WIN32
+				ssize_t nDone = pwrite(m_hFile, p, n, m_nSize);
+				TestSysRet(nDone <= 0, "pwrite");
+#endif // WIN32
+				p += nDone;
+				n -= (uint32_t) nDone;
+				m_nSize += nDone;
+			}
+
+			m_bDirty = true;
+		}
+
+		void Read(uint64_t nOffset, uint8_t* p, uint32_t n)
+		{
+			if (nOffset + n > m_nSize)
+			{
+				UpdateSize(); // may be appended by another handle
+				if (nOffset + n > m_nSize)
+					ThrowError("body out of segment");
+			}
+
+#ifndef WIN32
+			if (m_pMapping && (nOffset + n <= s_SegmentSize))
+			{
+				memcpy(p, m_pMapping + nOffset, n);
+				return;
+			}
+#endif // WIN32
+
+			while (n)
+			{
+#ifdef WIN32
+				OVERLAPPED ov;
+				ZeroObject(ov);
+				ov.Offset = (DWORD) nOffset;
+				ov.OffsetHigh = (DWORD) (nOffset >> 32);
+
+				DWORD nDone = 0;
+				TestSysRet(!ReadFile(m_hFile, p, n, &nDone, &ov) || !nDone, "ReadFile");
+#else // WIN32
+				ssize_t nDone = pread(m_hFile, p, n, nOffset);
+				TestSysRet(nDone <= 0, "pread");
+#endif // WIN32
+				p += nDone;
+				n -= (uint32_t) nDone;
+				nOffset += nDone;
+			}
+		}
+
+		void Sync()
+		{
+			if (m_bDirty)
+			{
+#ifdef WIN32
+				TestSysRet(!FlushFileBuffers(m_hFile), "FlushFileBuffers");
+#else // WIN32
+				TestSysRet(fsync(m_hFile) != 0, "fsync");
+#endif // WIN32
+				m_bDirty = false;
+			}
+		}
+	};
+
+	std::string m_sPrefix;
+	std::map<uint32_t, std::unique_ptr<Segment> > m_mapSegments; // opened on demand
+	std::set<uint32_t> m_setRelease; // to be deleted after the DB commit
+	uint32_t m_iActive = 0;
+	uint32_t m_iActiveSaved = 0; // SegmentHi param value in the current tx
+	bool m_bReadOnly = false;
+
+	// Segment IDs are never reused, so the readers keep the segments opened across the transactions.
+	// Once the writer deletes segments (process-wide counter) - the readers drop the ones that are gone
+	static std::atomic<uint32_t> s_nDeleted;
+	uint32_t m_nDeletedSeen = 0;
+
+	Segment& get_Segment(uint32_t iSegment)
+	{
+		std::unique_ptr<Segment>& pSeg = m_mapSegments[iSegment];
+		if (!pSeg)
+		{
+			std::unique_ptr<Segment> pNew(new Segment);
+			pNew->Open((m_sPrefix + std::to_string(iSegment)).c_str(), m_bReadOnly);
+			pSeg = std::move(pNew);
+		}
+		return *pSeg;
+	}
+
+	void Append(const Blob& body, BodyRef& ref)
+	{
+		// the active segment may contain leftovers (data written by rolled-back txs, or a stale file). Just append after it
+		while (true)
+		{
+			Segment& seg = get_Segment(m_iActive);
+			if (!seg.m_nSize || (seg.m_nSize + body.n <= s_SegmentSize))
+				break;
+			m_iActive++;
+		}
+
+		Segment& seg = get_Segment(m_iActive);
+		ref.m_iSegment = m_iActive;
+		ref.m_Offset = seg.m_nSize;
+		ref.m_Size = body.n;
+
+		seg.Write((const uint8_t*) body.p, body.n);
+	}
+
+	void Read(const BodyRef& ref, ByteBuffer& buf)
+	{
+		buf.resize(ref.m_Size);
+		get_Segment(ref.m_iSegment).Read(ref.m_Offset, &buf.front(), ref.m_Size);
+	}
+
+	void Sync()
+	{
+		for (auto it = m_mapSegments.begin(); m_mapSegments.end() != it; it++)
+			it->second->Sync();
+	}
+
+	void Delete(uint32_t iSegment)
+	{
+		m_mapSegments.erase(iSegment);
+
+		std::string sPath = m_sPrefix + std::to_string(iSegment);
+#ifdef WIN32
+		DeleteFileA(sPath.c_str());
+#else // WIN32
+		unlink(sPath.c_str());
+#endif // WIN32
+
+		s_nDeleted++;
+	}
+
+	void DropDeleted()
+	{
+		uint32_t nDeleted = s_nDeleted;
+		if (m_nDeletedSeen == nDeleted)
+			return;
+		m_nDeletedSeen = nDeleted;
+
+		// the newer snapshots don't reference the deleted segments
+		for (auto it = m_mapSegments.begin(); m_mapSegments.end() != it; )
+		{
+			std::string sPath = m_sPrefix + std::to_string(it->first);
+#ifdef WIN32
+			bool bExists = (INVALID_FILE_ATTRIBUTES != GetFileAttributesA(sPath.c_str()));
+#else // WIN32
+			bool bExists = !access(sPath.c_str(), F_OK);
+#endif // WIN32
+			if (bExists)
+				it++;
+			else
+				it = m_mapSegments.erase(it);
+		}
+	}
+};
+
+std::atomic<uint32_t> NodeDB::BodyStore::s_nDeleted(0);
+
+void NodeDB::OpenBodies(const char* szPath, bool bReadOnly)
+{
+	for (uint32_t iStore = 0; iStore < _countof(m_ppBodies); iStore++)
+	{
+		m_ppBodies[iStore].reset(new BodyStore);
+		BodyStore& bs = *m_ppBodies[iStore];
+
+		static const char* s_szSuffix[] = { ".bodyP.", ".bodyE.", ".txo." };
+		static_assert(_countof(s_szSuffix) == _countof(m_ppBodies), "");
+
+		bs.m_sPrefix = szPath;
+		bs.m_sPrefix += s_szSuffix[iStore];
+		bs.m_bReadOnly = bReadOnly;
+
+		if (bReadOnly)
+		{
+			bs.m_nDeletedSeen = BodyStore::s_nDeleted;
+			continue;
+		}
+
+		Recordset rs(*this);
+		switch (iStore)
+		{
+		case 0: rs.Reset(Query::BodySegMaxP, "SELECT MAX(" TblBodies_SegP ") FROM " TblBodies); break;
+		case 1: rs.Reset(Query::BodySegMaxE, "SELECT MAX(" TblBodies_SegE ") FROM " TblBodies); break;
+		default: rs.Reset(Query::TxoProofSegMax, "SELECT MAX(" TblTxoProofs_Seg ") FROM " TblTxoProofs);
+		}
+
+		if (rs.Step() && !rs.IsNull(0))
+			rs.get(0, bs.m_iActive);
+
+		// continue after the last used segment, even if it's not referenced anymore (or deleted)
+		uint64_t nHi = ParamIntGetDef(ParamID::SegmentHiP + iStore);
+		if (nHi > bs.m_iActive)
+			bs.m_iActive = static_cast<uint32_t>(nHi);
+		else if (nHi != bs.m_iActive)
+		{
+			nHi = bs.m_iActive;
+			ParamSet(ParamID::SegmentHiP + iStore, &nHi, NULL);
+		}
+
+		bs.m_iActiveSaved = bs.m_iActive;
+	}
+}
+
+void NodeDB::AppendBody(uint32_t iStore, const Blob& body, BodyRef& ref)
+{
+	BodyStore& bs = *m_ppBodies[iStore];
+	bs.Append(body, ref);
+
+	if (bs.m_iActive != bs.m_iActiveSaved)
+	{
+		uint64_t nHi = bs.m_iActive;
+		ParamSet(ParamID::SegmentHiP + iStore, &nHi, NULL);
+		bs.m_iActiveSaved = bs.m_iActive;
+	}
+}
+
+bool NodeDB::get_BodyRefs(uint64_t rowid, BodyRef* pRef)
+{
+	Recordset rs(*this, Query::BodyGet, "SELECT "
+		TblBodies_SegP "," TblBodies_OffsetP "," TblBodies_SizeP ","
+		TblBodies_SegE "," TblBodies_OffsetE "," TblBodies_SizeE
+		" FROM " TblBodies " WHERE " TblBodies_State "=?");
+	rs.put(0, rowid);
+	if (!rs.Step())
+		return false;
+
+	for (int i = 0; i < 2; i++)
+	{
+		BodyRef& ref = pRef[i];
+		if (rs.IsNull(i * 3))
+			ZeroObject(ref);
+		else
+		{
+			rs.get(i * 3, ref.m_iSegment);
+			rs.get(i * 3 + 1, ref.m_Offset);
+			rs.get(i * 3 + 2, ref.m_Size);
+		}
+	}
+
+	return true;
+}
+
+void NodeDB::set_BodyRefs(uint64_t rowid, const BodyRef* pRef)
+{
+	Recordset rs(*this);
+
+	if (!pRef[0].m_Size && !pRef[1].m_Size)
+	{
+		rs.Reset(Query::BodyDel, "DELETE FROM " TblBodies " WHERE " TblBodies_State "=?");
+		rs.put(0, rowid);
+		rs.Step();
+		return;
+	}
+
+	rs.Reset(Query::BodySet, "INSERT OR REPLACE INTO " TblBodies " VALUES(?,?,?,?,?,?,?)");
+	rs.put(0, rowid);
+
+	for (int i = 0; i < 2; i++)
+	{
+		const BodyRef& ref = pRef[i];
+		if (ref.m_Size)
+		{
+			rs.put(i * 3 + 1, ref.m_iSegment);
+			rs.put(i * 3 + 2, ref.m_Offset);
+			rs.put(i * 3 + 3, ref.m_Size);
+		}
+	}
 
 	rs.Step();
-	TestChanged1Row();
+}
+
+void NodeDB::PutBodies(uint64_t rowid, const Blob* pBody)
+{
+	BodyRef pOld[2];
+	if (!get_BodyRefs(rowid, pOld))
+		ZeroObject(pOld);
+
+	BodyRef pRef[2];
+	for (uint32_t i = 0; i < 2; i++)
+	{
+		if (pBody[i].n)
+			AppendBody(i, pBody[i], pRef[i]);
+		else
+			ZeroObject(pRef[i]);
+	}
+
+	if (sqlite3_get_autocommit(m_pDb))
+		SyncBodies(); // no tx, the index is committed right away
+
+	set_BodyRefs(rowid, pRef);
+
+	for (uint32_t i = 0; i < 2; i++)
+		ReleaseBodySegment(i, pOld[i]);
+}
+
+void NodeDB::ReleaseBodySegment(uint32_t iStore, const BodyRef& ref)
+{
+	BodyStore& bs = *m_ppBodies[iStore];
+	if (!ref.m_Size || (ref.m_iSegment == bs.m_iActive))
+		return;
+
+	Recordset rs(*this);
+	switch (iStore)
+	{
+	case 0: rs.Reset(Query::BodySegUsedP, "SELECT 1 FROM " TblBodies " WHERE " TblBodies_SegP "=? LIMIT 1"); break;
+	case 1: rs.Reset(Query::BodySegUsedE, "SELECT 1 FROM " TblBodies " WHERE " TblBodies_SegE "=? LIMIT 1"); break;
+	default: rs.Reset(Query::TxoProofSegUsed, "SELECT 1 FROM " TblTxoProofs " WHERE " TblTxoProofs_Seg "=? LIMIT 1");
+	}
+
+	rs.put(0, ref.m_iSegment);
+	if (rs.Step())
+		return; // still in use
+
+	if (sqlite3_get_autocommit(m_pDb))
+		bs.Delete(ref.m_iSegment);
+	else
+		bs.m_setRelease.insert(ref.m_iSegment); // should survive the rollback
+}
+
+void NodeDB::SyncBodies()
+{
+	for (size_t i = 0; i < _countof(m_ppBodies); i++)
+	{
+		if (!m_ppBodies[i])
+			continue;
+
+		m_ppBodies[i]->Sync(); // even in the lazy mode. Once the WAL is on disk, it must not refer to the data that isn't
+	}
+}
+
+void NodeDB::SyncFile(const char* szPath)
+{
+#ifdef WIN32
+	HANDLE hFile = CreateFileA(szPath, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, 0, NULL);
+	if (INVALID_HANDLE_VALUE == hFile)
+		return;
+
+	bool bOk = !!FlushFileBuffers(hFile);
+	DWORD nErrorCode = GetLastError();
+	CloseHandle(hFile);
+
+	SetLastError(nErrorCode);
+	BodyStore::TestSysRet(!bOk, "FlushFileBuffers");
+#else // WIN32
+	int hFile = open(szPath, O_RDONLY);
+	if (-1 == hFile)
+	{
+		BodyStore::TestSysRet(ENOENT != errno, "open");
+		return; // deleted already
+	}
+
+	bool bOk = !fsync(hFile);
+	int nErrorCode = errno;
+	close(hFile);
+
+	errno = nErrorCode;
+	BodyStore::TestSysRet(!bOk, "fsync");
+#endif // WIN32
+}
+
+uint64_t NodeDB::Checkpoint()
+{
+	int nLog = 0, nCkpt = 0;
+	TestRet(sqlite3_wal_checkpoint_v2(m_pDb, NULL, SQLITE_CHECKPOINT_PASSIVE, &nLog, &nCkpt));
+	return (nCkpt > 0) ? nCkpt : 0;
+}
+
+uint64_t NodeDB::get_PagesWritten()
+{
+	int nCur = 0, nHi = 0;
+	TestRet(sqlite3_db_status(m_pDb, SQLITE_DBSTATUS_CACHE_WRITE, &nCur, &nHi, 0));
+	return nCur;
+}
+
+void NodeDB::OnBodiesCommitted(bool bSuccess)
+{
+	for (size_t i = 0; i < _countof(m_ppBodies); i++)
+	{
+		if (!m_ppBodies[i])
+			continue;
+		BodyStore& bs = *m_ppBodies[i];
+
+		if (bSuccess)
+			for (auto it = bs.m_setRelease.begin(); bs.m_setRelease.end() != it; it++)
+				bs.Delete(*it);
+		else
+			bs.m_iActiveSaved = 0; // the param is rolled back, set it again on the next append
+
+		bs.m_setRelease.clear();
+
+		if (bs.m_bReadOnly)
+			bs.DropDeleted();
+	}
+}
+
+void NodeDB::SetStateBlock(uint64_t rowid, const Blob& bodyP, const Blob& bodyE)
+{
+	Blob pBody[] = { bodyP, bodyE };
+	PutBodies(rowid, pBody);
 }
 
 void NodeDB::GetStateBlock(uint64_t rowid, ByteBuffer* pP, ByteBuffer* pE)
 {
-	Recordset rs(*this, Query::StateGetBlock, "SELECT " TblStates_BodyP "," TblStates_BodyE " FROM " TblStates " WHERE rowid=?");
-	rs.put(0, rowid);
-	rs.StepStrict();
+	BodyRef pRef[2];
+	if (!get_BodyRefs(rowid, pRef))
+		return;
 
-	if (pP && !rs.IsNull(0))
-		rs.get(0, *pP);
-	if (pE && !rs.IsNull(1))
-		rs.get(1, *pE);
+	if (pP && pRef[0].m_Size)
+		m_ppBodies[0]->Read(pRef[0], *pP);
+	if (pE && pRef[1].m_Size)
+		m_ppBodies[1]->Read(pRef[1], *pE);
 }
 
 void NodeDB::DelStateBlockPP(uint64_t rowid)
 {
-	Recordset rs(*this, Query::StateDelBlock, "UPDATE " TblStates " SET " TblStates_BodyP "=NULL," TblStates_Peer "=NULL WHERE rowid=?");
+	Recordset rs(*this, Query::StateDelBlock, "UPDATE " TblStates " SET " TblStates_Peer "=NULL WHERE rowid=?");
 	rs.put(0, rowid);
 	rs.Step();
 	TestChanged1Row();
+
+	BodyRef pRef[2];
+	if (get_BodyRefs(rowid, pRef) && pRef[0].m_Size)
+	{
+		BodyRef refP = pRef[0];
+		ZeroObject(pRef[0]);
+
+		set_BodyRefs(rowid, pRef);
+		ReleaseBodySegment(0, refP);
+	}
 }
 
 void NodeDB::DelStateBlockAll(uint64_t rowid)
@@ -1634,6 +2322,12 @@ void NodeDB::FindEvents(WalkerEvent& x, const Blob& key)
 	x.m_Rs.put(0, key);
 }
 
+void NodeDB::FindEventsFrom(WalkerEvent& x, const Blob& key)
+{
+	x.m_Rs.Reset(Query::EventFindFrom, "SELECT " TblEvents_Height "," TblEvents_Body "," TblEvents_Key " FROM " TblEvents " WHERE " TblEvents_Key ">=? ORDER BY " TblEvents_Key " ASC");
+	x.m_Rs.put(0, key);
+}
+
 bool NodeDB::WalkerEvent::MoveNext()
 {
 	if (!m_Rs.Step())
@@ -1933,6 +2627,7 @@ void NodeDB::ResetCursor()
 
 	rs.Reset(Query::KernelDelAll, "DELETE FROM " TblKernels);
 	rs.Step();
+	m_pKrnCache.reset();
 
 	DeleteEventsFrom(Rules::HeightGenesis);
 
@@ -1942,6 +2637,193 @@ void NodeDB::ResetCursor()
 	put_Cursor(sid);
 }
 
+struct NodeDB::KernelCache
+{
+	struct Filter
+	{
+		// Counting Bloom filter, split into cache-line blocks. Each key sets s_Probes counters within a single block.
+		// Saturated counters are never decremented.
+		static const uint32_t s_BlockSize = 64;
+		static const uint32_t s_Probes = 4;
+		static const uint32_t s_CountersPerKey = 8; // min, grows up to x2 before the rebuild. False positive rate is about 2%
+
+		std::vector<uint8_t> m_vCounters;
+		uint64_t m_Keys = 0;
+
+		static uint64_t get_Hash(const Blob& key)
+		{
+			// FNV-1a. Kernel IDs are hashes already, just fold them
+			uint64_t hv = 0xcbf29ce484222325ULL;
+			for (uint32_t i = 0; i < key.n; i++)
+				hv = (hv ^ reinterpret_cast<const uint8_t*>(key.p)[i]) * 0x100000001b3ULL;
+			return hv;
+		}
+
+		void Reset(uint64_t nKeys)
+		{
+			size_t nSize = s_BlockSize * 0x400;
+			while (nSize < nKeys * s_CountersPerKey)
+				nSize <<= 1;
+
+			m_vCounters.assign(nSize, 0);
+			m_Keys = 0;
+		}
+
+		bool IsFull() const
+		{
+			return m_Keys * s_CountersPerKey > m_vCounters.size();
+		}
+
+		uint8_t* get_Block(uint64_t hv)
+		{
+			size_t nBlocks = m_vCounters.size() / s_BlockSize; // power of 2
+			return &m_vCounters.front() + s_BlockSize * static_cast<size_t>((hv >> 32) & (nBlocks - 1));
+		}
+
+		static uint32_t get_Pos(uint64_t hv, uint32_t iProbe)
+		{
+			return static_cast<uint32_t>(hv >> (iProbe * 6)) & (s_BlockSize - 1);
+		}
+
+		void Add(uint64_t hv)
+		{
+			uint8_t* pBlock = get_Block(hv);
+			for (uint32_t i = 0; i < s_Probes; i++)
+			{
+				uint8_t& x = pBlock[get_Pos(hv, i)];
+				if (x != 0xff)
+					x++;
+			}
+			m_Keys++;
+		}
+
+		void Remove(uint64_t hv)
+		{
+			uint8_t* pBlock = get_Block(hv);
+			for (uint32_t i = 0; i < s_Probes; i++)
+			{
+				uint8_t& x = pBlock[get_Pos(hv, i)];
+				assert(x);
+				if (x != 0xff)
+					x--;
+			}
+			m_Keys--;
+		}
+
+		bool Test(uint64_t hv)
+		{
+			uint8_t* pBlock = get_Block(hv);
+			for (uint32_t i = 0; i < s_Probes; i++)
+				if (!pBlock[get_Pos(hv, i)])
+					return false;
+			return true;
+		}
+
+	} m_Filter;
+
+	struct Lru
+	{
+		// recent hits, only for the standard kernel IDs
+		static const uint32_t s_Max = 0x4000;
+
+		struct Entry
+			:public boost::intrusive::set_base_hook<>
+			,public boost::intrusive::list_base_hook<>
+		{
+			Merkle::Hash m_Key;
+			Height m_Height;
+
+			bool operator < (const Entry& x) const { return m_Key < x.m_Key; }
+		};
+
+		typedef boost::intrusive::set<Entry> Set;
+		typedef boost::intrusive::list<Entry> List;
+
+		Set m_Set;
+		List m_List; // most recent at the back
+		Entry m_Tmp; // for search
+
+		~Lru()
+		{
+			while (!m_List.empty())
+				Delete(m_List.front());
+		}
+
+		Entry* Find(const Blob& key)
+		{
+			if (key.n != sizeof(m_Tmp.m_Key))
+				return nullptr;
+
+			memcpy(m_Tmp.m_Key.m_pData, key.p, key.n);
+			Set::iterator it = m_Set.find(m_Tmp);
+			if (m_Set.end() == it)
+				return nullptr;
+
+			Entry& x = *it;
+			m_List.erase(List::s_iterator_to(x));
+			m_List.push_back(x);
+			return &x;
+		}
+
+		void Insert(const Blob& key, Height h)
+		{
+			if ((key.n != sizeof(m_Tmp.m_Key)) || Find(key))
+				return;
+
+			if (m_List.size() >= s_Max)
+				Delete(m_List.front());
+
+			Entry* pE = new Entry;
+			memcpy(pE->m_Key.m_pData, key.p, key.n);
+			pE->m_Height = h;
+
+			m_Set.insert(*pE);
+			m_List.push_back(*pE);
+		}
+
+		void Delete(Entry& x)
+		{
+			m_Set.erase(Set::s_iterator_to(x));
+			m_List.erase(List::s_iterator_to(x));
+			delete &x;
+		}
+
+	} m_Lru;
+};
+
+NodeDB::KernelCache* NodeDB::get_KrnCache()
+{
+	if (!m_bKrnCache)
+		return nullptr;
+
+	if (!m_pKrnCache || m_pKrnCache->m_Filter.IsFull())
+	{
+		uint64_t nKeys = m_pKrnCache ? m_pKrnCache->m_Filter.m_Keys : 0;
+		m_pKrnCache.reset(new KernelCache);
+		KernelCache::Filter& f = m_pKrnCache->m_Filter;
+
+		while (true)
+		{
+			f.Reset(nKeys * 2);
+
+			Recordset rs(*this, Query::KernelEnumAll, "SELECT " TblKernels_Key " FROM " TblKernels);
+			while (rs.Step())
+			{
+				Blob key;
+				rs.get(0, key);
+				f.Add(f.get_Hash(key));
+			}
+
+			if (!f.IsFull())
+				break;
+
+			nKeys = f.m_Keys; // the initial build, or the table has much more kernels than expected. Rescan
+		}
+	}
+
+	return m_pKrnCache.get();
+}
+
 void NodeDB::InsertKernel(const Blob& key, Height h)
 {
 	assert(h >= Rules::HeightGenesis);
@@ -1951,6 +2833,15 @@ void NodeDB::InsertKernel(const Blob& key, Height h)
 	rs.put(1, h);
 	rs.Step();
 	TestChanged1Row();
+
+	if (m_pKrnCache)
+	{
+		m_pKrnCache->m_Filter.Add(KernelCache::Filter::get_Hash(key));
+
+		KernelCache::Lru::Entry* pE = m_pKrnCache->m_Lru.Find(key);
+		if (pE && (pE->m_Height < h))
+			pE->m_Height = h;
+	}
 }
 
 void NodeDB::DeleteKernel(const Blob& key, Height h)
@@ -1965,14 +2856,36 @@ void NodeDB::DeleteKernel(const Blob& key, Height h)
 	uint32_t nRows = get_RowsChanged();
 	if (!nRows)
 		ThrowError("no krn");
-	else
-		// in the *very* unlikely case of kernel duplicate at the same height (!!!) - just re-insert it
-		while (--nRows)
-			InsertKernel(key, h);
+
+	if (m_pKrnCache)
+	{
+		uint64_t hv = KernelCache::Filter::get_Hash(key);
+		for (uint32_t i = 0; i < nRows; i++)
+			m_pKrnCache->m_Filter.Remove(hv);
+
+		KernelCache::Lru::Entry* pE = m_pKrnCache->m_Lru.Find(key);
+		if (pE)
+			m_pKrnCache->m_Lru.Delete(*pE);
+	}
+
+	// in the *very* unlikely case of kernel duplicate at the same height (!!!) - just re-insert it
+	while (--nRows)
+		InsertKernel(key, h);
 }
 
 Height NodeDB::FindKernel(const Blob& key)
 {
+	KernelCache* pKc = get_KrnCache();
+	if (pKc)
+	{
+		if (!pKc->m_Filter.Test(KernelCache::Filter::get_Hash(key)))
+			return Rules::HeightGenesis - 1;
+
+		KernelCache::Lru::Entry* pE = pKc->m_Lru.Find(key);
+		if (pE)
+			return pE->m_Height;
+	}
+
 	Recordset rs(*this, Query::KernelFind, "SELECT " TblKernels_Height " FROM " TblKernels " WHERE " TblKernels_Key "=? ORDER BY " TblKernels_Height " DESC LIMIT 1");
 	rs.put(0, key);
 	if (!rs.Step())
@@ -1982,6 +2895,10 @@ Height NodeDB::FindKernel(const Blob& key)
 	rs.get(0, h);
 
 	assert(h >= Rules::HeightGenesis);
+
+	if (pKc)
+		pKc->m_Lru.Insert(key, h);
+
 	return h;
 }
 
@@ -1999,19 +2916,92 @@ Height NodeDB::FindBlock(const Blob& hash)
     return h;
 }
 
-void NodeDB::TxoAdd(TxoID id, const Blob& b)
+void NodeDB::TxoAdd(TxoID id, const Blob& valNaked, const Blob& valFull)
 {
 	Recordset rs(*this, Query::TxoAdd, "INSERT INTO " TblTxo "(" TblTxo_ID "," TblTxo_Value ") VALUES(?,?)");
 	rs.put(0, id);
-	rs.put(1, b);
+	rs.put(1, valNaked);
 	rs.Step();
+
+	if (valFull.n)
+		TxoAddProof(id, valFull);
+}
+
+void NodeDB::TxoMoveProof(TxoID id, const Blob& valNaked, const Blob& valFull)
+{
+	TxoAddProof(id, valFull); // copy it before the row is modified, valFull may point to it
+
+	Recordset rs(*this, Query::TxoSetValue, "UPDATE " TblTxo " SET " TblTxo_Value "=? WHERE " TblTxo_ID "=?");
+	rs.put(0, valNaked);
+	rs.put(1, id);
+	rs.Step();
+	TestChanged1Row();
+}
+
+void NodeDB::TxoAddProof(TxoID id, const Blob& valFull)
+{
+	const size_t nBatchMax = 1U << 24;
+
+	m_vTxoProofs.emplace_back();
+	TxoProofPending& x = m_vTxoProofs.back();
+	x.m_ID = id;
+	x.m_Offset = static_cast<uint32_t>(m_bufTxoProofs.size());
+	x.m_Size = valFull.n;
+
+	const uint8_t* p = reinterpret_cast<const uint8_t*>(valFull.p);
+	m_bufTxoProofs.insert(m_bufTxoProofs.end(), p, p + valFull.n);
+
+	if (sqlite3_get_autocommit(m_pDb) || (m_bufTxoProofs.size() >= nBatchMax))
+		TxoFlushProofs();
+}
+
+void NodeDB::TxoFlushProofs()
+{
+	if (m_vTxoProofs.empty())
+		return;
+
+	BodyRef ref;
+	AppendBody(2, Blob(m_bufTxoProofs), ref);
+
+	if (sqlite3_get_autocommit(m_pDb))
+		SyncBodies(); // no tx, the index is committed right away
+
+	Recordset rs(*this, Query::TxoProofAdd, "INSERT INTO " TblTxoProofs " VALUES(?,?,?,?)");
+	for (size_t i = 0; i < m_vTxoProofs.size(); i++)
+	{
+		const TxoProofPending& x = m_vTxoProofs[i];
+		rs.put(0, x.m_ID);
+		rs.put(1, ref.m_iSegment);
+		rs.put(2, ref.m_Offset + x.m_Offset);
+		rs.put(3, x.m_Size);
+		rs.Step();
+		rs.Reset();
+	}
+
+	m_bufTxoProofs.clear();
+	m_vTxoProofs.clear();
 }
 
 void NodeDB::TxoDelFrom(TxoID id)
 {
-	Recordset rs(*this, Query::TxoDelFrom, "DELETE FROM " TblTxo " WHERE " TblTxo_ID ">=?");
+	TxoFlushProofs();
+
+	std::vector<uint32_t> vSegs;
+	{
+		Recordset rs(*this, Query::TxoProofSegsFrom, "SELECT DISTINCT " TblTxoProofs_Seg " FROM " TblTxoProofs " WHERE " TblTxoProofs_ID ">=?");
+		rs.put(0, id);
+		get_TxoProofSegments(vSegs, rs);
+	}
+
+	Recordset rs(*this, Query::TxoProofDelFrom, "DELETE FROM " TblTxoProofs " WHERE " TblTxoProofs_ID ">=?");
+	rs.put(0, id);
+	rs.Step();
+
+	rs.Reset(Query::TxoDelFrom, "DELETE FROM " TblTxo " WHERE " TblTxo_ID ">=?");
 	rs.put(0, id);
 	rs.Step();
+
+	ReleaseTxoProofSegments(vSegs);
 }
 
 void NodeDB::TxoSetSpent(TxoID id, Height h)
@@ -2031,15 +3021,34 @@ void NodeDB::TxoDelSpentFrom(Height h)
 	rs.Step();
 }
 
+#define TblTxo_SelectFull \
+	"SELECT " TblTxo "." TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight "," TblTxoProofs_Seg "," TblTxoProofs_Offset "," TblTxoProofs_Size \
+	" FROM " TblTxo " LEFT JOIN " TblTxoProofs " ON " TblTxo "." TblTxo_ID "=" TblTxoProofs "." TblTxoProofs_ID
+
+#define TblTxo_SelectNaked \
+	"SELECT " TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight " FROM " TblTxo
+
 void NodeDB::EnumTxos(WalkerTxo& wlk, TxoID id0)
 {
-	wlk.m_Rs.Reset(Query::TxoEnum, "SELECT " TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight " FROM " TblTxo " WHERE " TblTxo_ID ">=? ORDER BY " TblTxo_ID);
+	TxoFlushProofs();
+
+	if (wlk.m_bNaked)
+		wlk.m_Rs.Reset(Query::TxoEnumNaked, TblTxo_SelectNaked " WHERE " TblTxo_ID ">=? ORDER BY " TblTxo_ID);
+	else
+		wlk.m_Rs.Reset(Query::TxoEnum, TblTxo_SelectFull " WHERE " TblTxo "." TblTxo_ID ">=? ORDER BY " TblTxo "." TblTxo_ID);
+
 	wlk.m_Rs.put(0, id0);
 }
 
 void NodeDB::EnumTxosBySpent(WalkerTxo& wlk, const HeightRange& hr)
 {
-	wlk.m_Rs.Reset(Query::TxoEnumBySpent, "SELECT " TblTxo_ID "," TblTxo_Value "," TblTxo_SpendHeight " FROM " TblTxo " WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? ORDER BY " TblTxo_SpendHeight);
+	TxoFlushProofs();
+
+	if (wlk.m_bNaked)
+		wlk.m_Rs.Reset(Query::TxoEnumBySpentNaked, TblTxo_SelectNaked " WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? ORDER BY " TblTxo_SpendHeight);
+	else
+		wlk.m_Rs.Reset(Query::TxoEnumBySpent, TblTxo_SelectFull " WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? ORDER BY " TblTxo_SpendHeight);
+
 	wlk.m_Rs.put(0, hr.m_Min);
 	wlk.m_Rs.put(1, std::min(hr.m_Max, (MaxHeight >> 1))); // sqlite uses signed int64
 }
@@ -2057,12 +3066,23 @@ bool NodeDB::WalkerTxo::MoveNext()
 	else
 		m_Rs.get(2, m_SpendHeight);
 
+	if (!m_bNaked && !m_Rs.IsNull(3))
+	{
+		BodyRef ref;
+		m_Rs.get(3, ref.m_iSegment);
+		m_Rs.get(4, ref.m_Offset);
+		m_Rs.get(5, ref.m_Size);
+
+		m_Rs.m_DB.ReadTxoProof(ref, m_bufFull);
+		m_Value = m_bufFull;
+	}
+
 	return true;
 }
 
 uint64_t NodeDB::DeleteSpentTxos(const HeightRange& hr, TxoID id0)
 {
-	assert(!hr.IsEmpty());
+	DeleteSpentTxoProofs(hr, id0);
 
 	Recordset rs(*this, Query::TxoDelSpentTxosFrom, "DELETE FROM " TblTxo " WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? AND " TblTxo_ID ">=?");
 	rs.put(0, hr.m_Min);
@@ -2073,22 +3093,186 @@ uint64_t NodeDB::DeleteSpentTxos(const HeightRange& hr, TxoID id0)
 	return static_cast<uint64_t>(get_RowsChanged());
 }
 
+uint64_t NodeDB::DeleteSpentTxoProofs(const HeightRange& hr, TxoID id0)
+{
+	assert(!hr.IsEmpty());
+	TxoFlushProofs();
+
+	std::vector<uint32_t> vSegs;
+	{
+		Recordset rs(*this, Query::TxoProofSegsSpent, "SELECT DISTINCT " TblTxoProofs_Seg " FROM " TblTxoProofs " WHERE " TblTxoProofs_ID " IN (SELECT " TblTxo_ID " FROM " TblTxo
+			" WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? AND " TblTxo_ID ">=?)");
+		rs.put(0, hr.m_Min);
+		rs.put(1, hr.m_Max);
+		rs.put(2, id0);
+		get_TxoProofSegments(vSegs, rs);
+	}
+
+	Recordset rs(*this, Query::TxoProofDelSpent, "DELETE FROM " TblTxoProofs " WHERE " TblTxoProofs_ID " IN (SELECT " TblTxo_ID " FROM " TblTxo
+		" WHERE " TblTxo_SpendHeight ">=? AND " TblTxo_SpendHeight "<=? AND " TblTxo_ID ">=?)");
+	rs.put(0, hr.m_Min);
+	rs.put(1, hr.m_Max);
+	rs.put(2, id0);
+	rs.Step();
+
+	uint64_t nRet = static_cast<uint64_t>(get_RowsChanged());
+
+	ReleaseTxoProofSegments(vSegs);
+	return nRet;
+}
+
 void NodeDB::TxoSetValue(TxoID id, const Blob& v)
 {
+	TxoFlushProofs();
+
 	Recordset rs(*this, Query::TxoSetValue, "UPDATE " TblTxo " SET " TblTxo_Value "=? WHERE " TblTxo_ID "=?");
 	rs.put(0, v);
 	rs.put(1, id);
 	rs.Step();
 	TestChanged1Row();
+
+	BodyRef ref;
+	if (get_TxoProofRef(id, ref))
+	{
+		rs.Reset(Query::TxoProofDel, "DELETE FROM " TblTxoProofs " WHERE " TblTxoProofs_ID "=?");
+		rs.put(0, id);
+		rs.Step();
+
+		ReleaseBodySegment(2, ref);
+	}
 }
 
 void NodeDB::TxoGetValue(WalkerTxo& wlk, TxoID id0)
 {
+	TxoFlushProofs();
+
 	wlk.m_Rs.Reset(Query::TxoGetValue, "SELECT " TblTxo_Value " FROM " TblTxo " WHERE " TblTxo_ID "=?");
 	wlk.m_Rs.put(0, id0);
 
 	wlk.m_Rs.StepStrict();
 	wlk.m_Rs.get(0, wlk.m_Value);
+
+	BodyRef ref;
+	if (!wlk.m_bNaked && get_TxoProofRef(id0, ref))
+	{
+		ReadTxoProof(ref, wlk.m_bufFull);
+		wlk.m_Value = wlk.m_bufFull;
+	}
+}
+
+bool NodeDB::get_TxoProofRef(TxoID id, BodyRef& ref)
+{
+	Recordset rs(*this, Query::TxoProofGet, "SELECT " TblTxoProofs_Seg "," TblTxoProofs_Offset "," TblTxoProofs_Size " FROM " TblTxoProofs " WHERE " TblTxoProofs_ID "=?");
+	rs.put(0, id);
+	if (!rs.Step())
+		return false;
+
+	rs.get(0, ref.m_iSegment);
+	rs.get(1, ref.m_Offset);
+	rs.get(2, ref.m_Size);
+	return true;
+}
+
+void NodeDB::ReadTxoProof(const BodyRef& ref, ByteBuffer& buf)
+{
+	m_ppBodies[2]->Read(ref, buf);
+}
+
+bool NodeDB::TxoCompactProofs(uint32_t& iSeg)
+{
+	TxoFlushProofs();
+
+	BodyStore& bs = *m_ppBodies[2];
+
+	Recordset rs(*this, Query::TxoProofSegNext, "SELECT MIN(" TblTxoProofs_Seg ") FROM " TblTxoProofs " WHERE " TblTxoProofs_Seg ">=?");
+	rs.put(0, iSeg);
+	if (!rs.Step() || rs.IsNull(0))
+		return false;
+
+	uint32_t iThis;
+	rs.get(0, iThis);
+	if (iThis >= bs.m_iActive)
+		return false;
+
+	iSeg = iThis + 1;
+
+	rs.Reset(Query::TxoProofSegLive, "SELECT SUM(" TblTxoProofs_Size ") FROM " TblTxoProofs " WHERE " TblTxoProofs_Seg "=?");
+	rs.put(0, iThis);
+	rs.StepStrict();
+
+	uint64_t nLive;
+	rs.get(0, nLive);
+
+	if (nLive * 2 >= bs.get_Segment(iThis).m_nSize)
+		return true; // not worth it
+
+	// gather the live proofs into a single blob, the rows are updated after the whole segment is read
+	std::vector<TxoProofPending> vLive;
+	ByteBuffer buf, bufProof;
+
+	rs.Reset(Query::TxoProofSegEnum, "SELECT " TblTxoProofs_ID "," TblTxoProofs_Offset "," TblTxoProofs_Size " FROM " TblTxoProofs " WHERE " TblTxoProofs_Seg "=?");
+	rs.put(0, iThis);
+
+	while (rs.Step())
+	{
+		BodyRef ref;
+		ref.m_iSegment = iThis;
+
+		vLive.emplace_back();
+		TxoProofPending& x = vLive.back();
+		rs.get(0, x.m_ID);
+		rs.get(1, ref.m_Offset);
+		rs.get(2, ref.m_Size);
+
+		bs.Read(ref, bufProof);
+
+		x.m_Offset = static_cast<uint32_t>(buf.size());
+		x.m_Size = ref.m_Size;
+		buf.insert(buf.end(), bufProof.begin(), bufProof.end());
+	}
+
+	BodyRef ref;
+	AppendBody(2, Blob(buf), ref);
+
+	if (sqlite3_get_autocommit(m_pDb))
+		SyncBodies(); // no tx, the index is committed right away
+
+	rs.Reset(Query::TxoProofMove, "UPDATE " TblTxoProofs " SET " TblTxoProofs_Seg "=?," TblTxoProofs_Offset "=? WHERE " TblTxoProofs_ID "=?");
+	for (size_t i = 0; i < vLive.size(); i++)
+	{
+		const TxoProofPending& x = vLive[i];
+		rs.put(0, ref.m_iSegment);
+		rs.put(1, ref.m_Offset + x.m_Offset);
+		rs.put(2, x.m_ID);
+		rs.Step();
+		TestChanged1Row();
+		rs.Reset();
+	}
+
+	ReleaseTxoProofSegments(std::vector<uint32_t>(1, iThis));
+	return true;
+}
+
+void NodeDB::get_TxoProofSegments(std::vector<uint32_t>& vSegs, Recordset& rs)
+{
+	while (rs.Step())
+	{
+		vSegs.emplace_back();
+		rs.get(0, vSegs.back());
+	}
+}
+
+void NodeDB::ReleaseTxoProofSegments(const std::vector<uint32_t>& vSegs)
+{
+	for (size_t i = 0; i < vSegs.size(); i++)
+	{
+		BodyRef ref;
+		ref.m_iSegment = vSegs[i];
+		ref.m_Offset = 0;
+		ref.m_Size = 1; // just non-zero
+
+		ReleaseBodySegment(2, ref);
+	}
 }
 
 } // namespace grimm
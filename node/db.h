@@ -28,6 +28,15 @@ public:
     {}
 };
 
+// Thrown to the read-only handle if the body segment referenced by its snapshot was already deleted by the writer. The read should be retried with a newer snapshot
+class NodeDBSegmentGoneException : public std::runtime_error
+{
+public:
+    NodeDBSegmentGoneException(const char* message)
+        : std::runtime_error(message)
+    {}
+};
+
 class NodeDB
 {
 public:
@@ -53,6 +62,11 @@ public:
 			HeightTxoLo, // Height starting from which and below Txo info is totally erased.
 			HeightTxoHi, // Height starting from which and below Txo infi is compacted, only the commitment is left
 			SyncData,
+			RescanTxo, // owned Txos rescan in progress: next TxoID, and the tag of the keys
+			SegmentHiP, // the last segment ever used by each body store (P, E, Txo). Segment IDs are never reused, the readers rely on it
+			SegmentHiE,
+			SegmentHiTxo,
+			TxoProofsUpgrade, // set if the full Txo values written by older versions may still be in the Txo table. Moved to the side log by the processor
 		};
 	};
 
@@ -64,6 +78,9 @@ public:
 			Commit,
 			Rollback,
 			Scheme,
+			AutoVacuumGet,
+			FreePages,
+			VacuumStep,
 			AutoincrementID,
 			ParamGet,
 			ParamIns,
@@ -112,10 +129,18 @@ public:
 			StateGetBlock,
 			StateSetBlock,
 			StateDelBlock,
+			BodyGet,
+			BodySet,
+			BodyDel,
+			BodySegUsedP,
+			BodySegUsedE,
+			BodySegMaxP,
+			BodySegMaxE,
 			EventIns,
 			EventDel,
 			EventEnum,
 			EventFind,
+			EventFindFrom,
 			PeerAdd,
 			PeerDel,
 			PeerEnum,
@@ -139,15 +164,31 @@ public:
 			KernelFind,
 			KernelDel,
 			KernelDelAll,
+			KernelEnumAll,
 			TxoAdd,
 			TxoDelFrom,
 			TxoSetSpent,
 			TxoDelSpentFrom,
 			TxoEnum,
+			TxoEnumNaked,
 			TxoEnumBySpent,
+			TxoEnumBySpentNaked,
 			TxoDelSpentTxosFrom,
 			TxoSetValue,
 			TxoGetValue,
+			TxoProofAdd,
+			TxoProofGet,
+			TxoProofDel,
+			TxoProofDelFrom,
+			TxoProofDelSpent,
+			TxoProofSegsFrom,
+			TxoProofSegsSpent,
+			TxoProofSegUsed,
+			TxoProofSegMax,
+			TxoProofSegNext,
+			TxoProofSegLive,
+			TxoProofSegEnum,
+			TxoProofMove,
 			BlockFind,
 			FindHeightBelow,
 
@@ -166,11 +207,32 @@ public:
 	virtual ~NodeDB();
 
 	void Close();
-	void Open(const char* szPath);
+	struct OpenMode {
+		enum Enum {
+			Exclusive,
+			Wal, // allows concurrent ReadOnly handles
+			WalLazy, // Wal, but commits don't fsync. The durability is up to the Checkpoint handle, see SyncFile()
+			ReadOnly, // sees the last committed state of the DB opened in Wal mode
+			Checkpoint, // only for Checkpoint() of the DB opened in WalLazy mode
+		};
+	};
 
-	void Vacuum();
+	void Open(const char* szPath, OpenMode::Enum = OpenMode::Exclusive);
+
+	void Vacuum(); // full, blocking. Also converts the DB to the incremental auto-vacuum mode
 	void CheckIntegrity();
 
+	// Incremental compaction. Free pages are moved to the end of the file and truncated on commit
+	static const uint32_t s_VacuumStepPages = 256;
+	bool IsIncrementalVacuum();
+	uint64_t get_FreePages();
+	void VacuumStep(); // up to s_VacuumStepPages pages
+
+	// WalLazy mode. The body segments are synced on commit anyway, only the WAL sync is deferred
+	static void SyncFile(const char* szPath); // missing file is ignored
+	uint64_t Checkpoint(); // passive, returns the number of the checkpointed pages
+	uint64_t get_PagesWritten(); // total since open
+
 	virtual void OnModified() {}
 
 	class Recordset
@@ -326,6 +388,7 @@ public:
 
 	void EnumEvents(WalkerEvent&, Height hMin);
 	void FindEvents(WalkerEvent&, const Blob& key);
+	void FindEventsFrom(WalkerEvent&, const Blob& key); // all the events with greater or equal key, ordered by key
 
 	struct WalkerPeer
 	{
@@ -429,7 +492,11 @@ public:
 
 	uint64_t FindStateWorkGreater(const Difficulty::Raw&);
 
-	void TxoAdd(TxoID, const Blob&);
+	// The Txo table keeps only the naked values (commitment, maturity). The rest of the output (the proofs) goes to the side log,
+	// so that the table stays compact, and the proofs of the txos below the compaction horizon are freed by whole segments.
+	void TxoAdd(TxoID, const Blob& valNaked, const Blob& valFull); // valFull may be empty if the txo is naked already
+	void TxoMoveProof(TxoID, const Blob& valNaked, const Blob& valFull); // replace the full value in the table by the naked one, the full goes to the side log
+	void TxoFlushProofs(); // the proofs are buffered and written by a single append. Flushed implicitly before they're accessed, and on commit
 	void TxoDelFrom(TxoID);
 	void TxoSetSpent(TxoID, Height);
 	void TxoDelSpentFrom(Height);
@@ -440,6 +507,8 @@ public:
 		TxoID m_ID;
 		Blob m_Value;
 		Height m_SpendHeight;
+		bool m_bNaked = false; // set before enum if only the naked values are needed, the side log isn't read then
+		ByteBuffer m_bufFull;
 
 		WalkerTxo(NodeDB& db) :m_Rs(db) {}
 		bool MoveNext();
@@ -448,7 +517,11 @@ public:
 	void EnumTxos(WalkerTxo&, TxoID id0);
 	void EnumTxosBySpent(WalkerTxo&, const HeightRange&);
 	uint64_t DeleteSpentTxos(const HeightRange&, TxoID id0); // delete Txos where (SpendHeight is within range) AND (TxoID >= id0)
-	void TxoSetValue(TxoID, const Blob&);
+	uint64_t DeleteSpentTxoProofs(const HeightRange&, TxoID id0); // same condition, but only the proofs are deleted, the naked values are left
+	// Checks the next side log segment starting from iSeg (the active one is skipped). If less than a half of it is alive - the live proofs are
+	// copied to the active segment, and the old one is deleted once committed. Returns false if there're no more segments to check
+	bool TxoCompactProofs(uint32_t& iSeg);
+	void TxoSetValue(TxoID, const Blob&); // the proof (if any) is dropped
 	void TxoGetValue(WalkerTxo&, TxoID);
 
 	// reset cursor to zero. Keep all the data: local peers, bbs, dummy UTXOs
@@ -500,6 +573,52 @@ private:
 	void TestChanged1Row();
 
 	struct Dmmr;
+
+	// Block bodies are kept in append-only segment files, out of the States table. The DB only indexes their locations.
+	struct BodyRef
+	{
+		uint64_t m_Offset;
+		uint32_t m_iSegment;
+		uint32_t m_Size; // 0 if absent
+	};
+
+	struct BodyStore;
+	std::unique_ptr<BodyStore> m_ppBodies[3]; // perishable, ethernal, txo proofs
+
+	void CreateTableBodies();
+	void MigrateBodies();
+	void CreateTableTxoProofs();
+	void OpenBodies(const char* szPath, bool bReadOnly);
+	bool get_BodyRefs(uint64_t rowid, BodyRef*);
+	void set_BodyRefs(uint64_t rowid, const BodyRef*);
+	void PutBodies(uint64_t rowid, const Blob* pBody);
+	void AppendBody(uint32_t iStore, const Blob&, BodyRef&);
+	void ReleaseBodySegment(uint32_t iStore, const BodyRef&);
+	void ReleaseTxoProofSegments(const std::vector<uint32_t>&);
+	void get_TxoProofSegments(std::vector<uint32_t>&, Recordset&);
+	bool get_TxoProofRef(TxoID, BodyRef&);
+	void ReadTxoProof(const BodyRef&, ByteBuffer&);
+	void TxoAddProof(TxoID, const Blob& valFull);
+
+	struct TxoProofPending
+	{
+		TxoID m_ID;
+		uint32_t m_Offset; // within the buffer
+		uint32_t m_Size;
+	};
+
+	ByteBuffer m_bufTxoProofs;
+	std::vector<TxoProofPending> m_vTxoProofs;
+	void SyncBodies();
+	void OnBodiesCommitted(bool bSuccess);
+
+	// Kernel lookup cache (writer only): counting Bloom filter over all the kernel IDs, and LRU of the recent hits.
+	// Negative lookups don't reach the DB. Dropped on rollback, rebuilt from the table on demand.
+	struct KernelCache;
+	std::unique_ptr<KernelCache> m_pKrnCache;
+	bool m_bKrnCache = false;
+
+	KernelCache* get_KrnCache();
 };
 
 
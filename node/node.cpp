@@ -830,6 +830,54 @@ void Node::Processor::TryGoUpAsync()
 	}
 }
 
+void Node::Processor::OnPruned()
+{
+	get_ParentObj().m_BodyCache.Clear(); // rows of the deleted states may be reused
+	ScheduleCompact();
+}
+
+void Node::Processor::ScheduleCompact()
+{
+	if (!m_bCompactPending)
+	{
+		if (!m_pCompactTimer)
+			m_pCompactTimer = io::Timer::create(io::Reactor::get_Current());
+
+		m_pCompactTimer->start(get_ParentObj().m_Cfg.m_Compaction.m_Period_ms, false, [this]() { OnCompactTimer(); });
+
+		m_bCompactPending = true;
+	}
+}
+
+void Node::Processor::OnCompactTimer()
+{
+	m_bCompactPending = false;
+
+	if (CompactStep(get_ParentObj().m_Cfg.m_Compaction.m_Budget_ms))
+		ScheduleCompact(); // next slice
+}
+
+void Node::Processor::TryGoUpDurable()
+{
+	m_nGoUpCommitSeq = m_nCommitSeq;
+	OnDurableTimer();
+}
+
+void Node::Processor::OnDurableTimer()
+{
+	if (IsDurable(m_nGoUpCommitSeq))
+	{
+		TryGoUpAsync();
+		return;
+	}
+
+	// the sync thread doesn't block the reactor, poll it
+	if (!m_pDurableTimer)
+		m_pDurableTimer = io::Timer::create(io::Reactor::get_Current());
+
+	m_pDurableTimer->start(1, false, [this]() { OnDurableTimer(); });
+}
+
 void Node::Processor::OnGoUpTimer()
 {
 	m_bGoUpPending = false;
@@ -901,6 +949,7 @@ Node::Peer* Node::AllocPeer(const grimm::io::Address& addr)
     m_lstPeers.push_back(*pPeer);
 
 	pPeer->m_UnsentHiMark = m_Cfg.m_BandwidthCtl.m_Drown;
+	pPeer->m_pIoThreads = m_pIoThreads.get();
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
@@ -909,6 +958,7 @@ Node::Peer* Node::AllocPeer(const grimm::io::Address& addr)
     pPeer->m_LoginFlags = 0;
 	pPeer->m_CursorBbs = std::numeric_limits<int64_t>::max();
 	pPeer->m_pCursorTx = nullptr;
+	pPeer->m_TxPending = 0;
 
     LOG_INFO() << "+Peer " << addr;
 
@@ -961,6 +1011,9 @@ void Node::Initialize(IExternalPOW* externalPOW)
 	ZeroObject(m_SyncStatus);
     RefreshCongestions();
 
+    if (m_Cfg.m_IoThreads)
+        m_pIoThreads = std::make_unique<proto::IoThreads>(m_Cfg.m_IoThreads);
+
     if (m_Cfg.m_Listen.port())
     {
         m_Server.Listen(m_Cfg.m_Listen);
@@ -1050,7 +1103,7 @@ void Node::RefreshOwnedUtxos()
 	if (hv0 == hv1)
 		return; // unchaged
 
-	m_Processor.RescanOwnedTxos();
+	m_Processor.RescanOwnedTxos(&hv0);
 
 	blob = Blob(hv0);
 	m_Processor.get_DB().ParamSet(NodeDB::ParamID::DummyID, NULL, &blob);
@@ -1121,12 +1174,15 @@ Node::~Node()
     while (!m_lstPeers.empty())
         m_lstPeers.front().DeleteSelf(false, proto::NodeConnection::ByeReason::Stopping);
 
+    m_pIoThreads.reset(); // the connections are closed in the I/O threads
+
     while (!m_lstTasksUnassigned.empty())
         DeleteUnassignedTask(m_lstTasksUnassigned.front());
 
     assert(m_setTasks.empty());
 
 	m_Processor.m_TaskProcessor.Stop();
+	m_TxAdmission.Clear();
 
 	if (!std::uncaught_exceptions())
 		m_PeerMan.OnFlush();
@@ -1500,6 +1556,9 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 
 	SetTxCursor(nullptr);
 
+	if (m_TxPending)
+		m_This.m_TxAdmission.OnPeerDeleted(*this);
+
     m_This.m_lstPeers.erase(PeerList::s_iterator_to(*this));
     delete this;
 }
@@ -1702,39 +1761,26 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
     if (msg.m_vElements.empty() || (msg.m_vElements.size() > proto::g_HdrPackMaxSize))
         ThrowUnexpected();
 
-    Block::SystemState::Full s;
-    Cast::Down<Block::SystemState::Sequence::Prefix>(s) = msg.m_Prefix;
-    Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements.back();
+    // unpack the headers, PoW is verified in parallel by the processor
+    std::vector<Block::SystemState::Full> vStates(msg.m_vElements.size());
 
-    uint32_t nAccepted = 0;
-    bool bInvalid = false;
+    Cast::Down<Block::SystemState::Sequence::Prefix>(vStates.front()) = msg.m_Prefix;
+    Cast::Down<Block::SystemState::Sequence::Element>(vStates.front()) = msg.m_vElements.back();
 
-	Block::SystemState::ID idLast;
-
-    for (size_t i = msg.m_vElements.size(); ; )
+    for (size_t i = 1; i < vStates.size(); i++)
     {
-        NodeProcessor::DataStatus::Enum eStatus = m_This.m_Processor.OnStateSilent(s, m_pInfo->m_ID.m_Key, idLast);
-        switch (eStatus)
-        {
-        case NodeProcessor::DataStatus::Invalid:
-            bInvalid = true;
-            break;
-
-        case NodeProcessor::DataStatus::Accepted:
-            nAccepted++;
-
-        default:
-            break; // suppress warning
-        }
-
-        if (! --i)
-            break;
-
+        Block::SystemState::Full& s = vStates[i];
+        s = vStates[i - 1];
         s.NextPrefix();
-        Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements[i - 1];
+        Cast::Down<Block::SystemState::Sequence::Element>(s) = msg.m_vElements[vStates.size() - 1 - i];
         s.m_ChainWork += s.m_PoW.m_Difficulty;
     }
 
+    bool bInvalid = false;
+	Block::SystemState::ID idLast;
+
+    uint32_t nAccepted = m_This.m_Processor.OnStatePack(&vStates.front(), static_cast<uint32_t>(vStates.size()), m_pInfo->m_ID.m_Key, idLast, bInvalid);
+
     // just to be pedantic
     if (idLast != t.m_Key.first)
         bInvalid = true;
@@ -1784,7 +1830,7 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 				if (NodeDB::StateFlags::Active & p.get_DB().GetStateFlags(sid.m_Row))
 				{
 					// functionality only supported for active states
-					proto::BodyPack msgBody;
+					proto::BodyPackRef msgBody;
 					size_t nSize = 0;
 
 					sid.m_Height -= msg.m_CountExtra;
@@ -1794,18 +1840,18 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 					{
 						sid.m_Row = p.FindActiveAtStrict(sid.m_Height);
 
-						proto::BodyBuffers bb;
-						if (!GetBlock(bb, sid, msg))
+						std::shared_ptr<const proto::BodyBuffers> pBody;
+						if (!GetBlockShared(pBody, sid, msg))
 							break;
 
-						nSize += bb.m_Eternal.size() + bb.m_Perishable.size();
-						msgBody.m_Bodies.push_back(std::move(bb));
+						nSize += BodyCache::get_Size(*pBody);
+						msgBody.m_vBodies.push_back(std::move(pBody));
 
 						if (nSize >= m_This.m_Cfg.m_BandwidthCtl.m_MaxBodyPackSize)
 							break;
 					}
 
-					if (msgBody.m_Bodies.size())
+					if (msgBody.m_vBodies.size())
 					{
 						Send(msgBody);
 						return;
@@ -1893,6 +1939,111 @@ bool Node::Peer::GetBlock(proto::BodyBuffers& out, const NodeDB::StateID& sid, c
 	return true;
 }
 
+bool Node::Peer::GetBlockShared(std::shared_ptr<const proto::BodyBuffers>& pRes, const NodeDB::StateID& sid, const proto::GetBodyPack& msg)
+{
+	// Only full blocks are shared. They don't depend on the requester's horizons, and almost all the peers ask for them
+	size_t nMaxSize = m_This.m_Cfg.m_BandwidthCtl.m_BodyCacheSize;
+	bool bShared = nMaxSize && (msg.m_HorizonHi1 <= sid.m_Height);
+
+	BodyCache::Key key;
+	if (bShared)
+	{
+		key.m_Row = sid.m_Row;
+		key.m_Height0 = msg.m_Height0;
+		key.m_HorizonLo1 = msg.m_HorizonLo1;
+		key.m_FlagP = msg.m_FlagP;
+		key.m_FlagE = msg.m_FlagE;
+
+		const std::shared_ptr<const proto::BodyBuffers>* ppBody = m_This.m_BodyCache.Find(key);
+		if (ppBody)
+		{
+			// still must be served according to our current horizons
+			if (!m_This.m_Processor.GetBlock(sid, nullptr, nullptr, msg.m_Height0, msg.m_HorizonLo1, msg.m_HorizonHi1))
+				return false;
+
+			pRes = *ppBody;
+			return true;
+		}
+	}
+
+	std::shared_ptr<proto::BodyBuffers> pBody = std::make_shared<proto::BodyBuffers>();
+	if (!GetBlock(*pBody, sid, msg))
+		return false;
+
+	pRes = std::move(pBody);
+
+	if (bShared)
+		m_This.m_BodyCache.Insert(key, pRes, nMaxSize);
+
+	return true;
+}
+
+bool Node::BodyCache::Key::operator < (const Key& x) const
+{
+	if (m_Row != x.m_Row)
+		return m_Row < x.m_Row;
+	if (m_Height0 != x.m_Height0)
+		return m_Height0 < x.m_Height0;
+	if (m_HorizonLo1 != x.m_HorizonLo1)
+		return m_HorizonLo1 < x.m_HorizonLo1;
+	if (m_FlagP != x.m_FlagP)
+		return m_FlagP < x.m_FlagP;
+	return m_FlagE < x.m_FlagE;
+}
+
+const std::shared_ptr<const proto::BodyBuffers>* Node::BodyCache::Find(const Key& key)
+{
+	Entry eTmp;
+	eTmp.m_Key = key;
+
+	Set::iterator it = m_Set.find(eTmp);
+	if (m_Set.end() == it)
+		return nullptr;
+
+	Entry& x = *it;
+	m_List.erase(List::s_iterator_to(x));
+	m_List.push_back(x);
+	return &x.m_pBody;
+}
+
+void Node::BodyCache::Insert(const Key& key, const std::shared_ptr<const proto::BodyBuffers>& pBody, size_t nMaxSize)
+{
+	size_t nSize = get_Size(*pBody);
+	if (nSize > nMaxSize)
+		return;
+
+	while (!m_List.empty() && (m_Size + nSize > nMaxSize))
+		Delete(m_List.front());
+
+	Entry* pE = new Entry;
+	pE->m_Key = key;
+	pE->m_pBody = pBody;
+
+	std::pair<Set::iterator, bool> res = m_Set.insert(*pE);
+	if (!res.second)
+	{
+		delete pE;
+		return;
+	}
+
+	m_List.push_back(*pE);
+	m_Size += nSize;
+}
+
+void Node::BodyCache::Delete(Entry& x)
+{
+	m_Size -= get_Size(*x.m_pBody);
+	m_Set.erase(Set::s_iterator_to(x));
+	m_List.erase(List::s_iterator_to(x));
+	delete &x;
+}
+
+void Node::BodyCache::Clear()
+{
+	while (!m_List.empty())
+		Delete(m_List.front());
+}
+
 void Node::Peer::OnMsg(proto::Body&& msg)
 {
 	Task& t = get_FirstTask();
@@ -1982,23 +2133,278 @@ void Node::Peer::OnMsg(proto::NewTransaction&& msg)
         ThrowUnexpected(); // our deserialization permits NULL Ptrs.
     // However the transaction body must have already been checked for NULLs
 
-    if (msg.m_Fluff)
-        m_This.OnTransactionFluff(std::move(msg.m_Transaction), this, NULL);
-    else
-    {
-        proto::Status msgOut;
-		msgOut.m_Value = m_This.OnTransactionStem(std::move(msg.m_Transaction), this);
+	const Transaction& tx = *msg.m_Transaction;
 
-		if (!(proto::LoginFlags::Extension3 & m_LoginFlags) && (proto::TxStatus::Ok != msgOut.m_Value))
-			msgOut.m_Value = proto::TxStatus::Unspecified; // legacy client
+	if (msg.m_Fluff)
+	{
+		TxPool::Fluff::Element::Tx key;
+		tx.get_Key(key.m_Key);
 
-        Send(msgOut);
-    }
+		if (m_This.m_TxPool.m_setTxs.end() != m_This.m_TxPool.m_setTxs.find(key))
+			return; // already have it, no need to verify
+	}
+	else
+	{
+		if (tx.m_vInputs.empty() || tx.m_vKernels.empty())
+		{
+			SendTxStatus(proto::TxStatus::TooSmall);
+			return;
+		}
+
+		if (m_This.IsStemDup(tx))
+		{
+			// handled without verification
+			SendTxStatus(m_This.OnTransactionStem(std::move(msg.m_Transaction), this));
+			return;
+		}
+	}
+
+	if (m_TxPending >= m_This.m_Cfg.m_MaxPendingTxsPerPeer)
+	{
+		// back-pressure. The peer is flooding us faster than we verify
+		LOG_WARNING() << "Peer " << m_RemoteAddr << " too many pending txs, rejected";
+
+		if (!msg.m_Fluff)
+			SendTxStatus(proto::TxStatus::Unspecified);
+		return;
+	}
+
+	m_This.m_TxAdmission.Push(std::move(msg.m_Transaction), *this, msg.m_Fluff);
 }
 
-uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx)
+void Node::Peer::SendTxStatus(uint8_t nStatus)
 {
-	if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
+	proto::Status msgOut;
+	msgOut.m_Value = nStatus;
+
+	if (!(proto::LoginFlags::Extension3 & m_LoginFlags) && (proto::TxStatus::Ok != msgOut.m_Value))
+		msgOut.m_Value = proto::TxStatus::Unspecified; // legacy client
+
+	Send(msgOut);
+}
+
+struct Node::TxAdmission::MyTask
+	:public NodeProcessor::Task
+{
+	TxAdmission* m_pThis;
+	std::vector<Request*> m_vReqs;
+
+	virtual void Exec() override
+	{
+		for (size_t i = 0; i < m_vReqs.size(); i++)
+			m_vReqs[i]->m_bValid = true; // until proven otherwise
+
+		if (!Verify(0, m_vReqs.size()) && (m_vReqs.size() > 1))
+		{
+			// Find the offending txs. Verify the rest one by one, this costs at most one extra pass.
+			// Note that the failed batch may also be caused by partially verified txs that were already rejected
+			for (size_t i = 0; i < m_vReqs.size(); i++)
+				Verify(i, i + 1);
+		}
+
+		{
+			std::unique_lock<std::mutex> scope(m_pThis->m_Mutex);
+			m_pThis->m_queDone.insert(m_pThis->m_queDone.end(), m_vReqs.begin(), m_vReqs.end());
+		}
+
+		m_pThis->m_pEvtDone->post();
+	}
+
+	bool Verify(size_t i0, size_t i1)
+	{
+		// Use a dedicated batch. The one of the thread may contain pending proofs of the blocks being verified
+		typedef Node::Processor::TaskProcessor::MyBatch MyBatch;
+		std::unique_ptr<MyBatch> pBc(new MyBatch);
+
+		bool bBatchValid;
+		{
+			MyBatch::Scope scopeBatch(*pBc);
+
+			uint32_t nCandidates = 0;
+			for (size_t i = i0; i < i1; i++)
+			{
+				Request& r = *m_vReqs[i];
+				if (!r.m_bValid)
+					continue;
+
+				r.m_Ctx.Reset();
+				r.m_Ctx.m_Height.m_Min = r.m_hMin;
+
+				r.m_bValid =
+					r.m_Ctx.ValidateAndSummarize(*r.m_pTx, r.m_pTx->get_Reader()) &&
+					r.m_Ctx.IsValidTransaction();
+
+				if (r.m_bValid)
+					nCandidates++;
+			}
+
+			if (!nCandidates)
+				return true;
+
+			bBatchValid = pBc->Flush();
+		}
+
+		if (!bBatchValid && (i1 - i0 == 1))
+			m_vReqs[i0]->m_bValid = false;
+
+		return bBatchValid;
+	}
+};
+
+void Node::TxAdmission::Push(Transaction::Ptr&& ptx, Peer& peer, bool bFluff)
+{
+	if (!m_pEvtDone)
+	{
+		io::AsyncEvent::Callback cb = [this]() { OnDone(); };
+		m_pEvtDone = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	Request* pReq = new Request;
+	m_lstPending.push_back(*pReq);
+
+	pReq->m_pTx = std::move(ptx);
+	pReq->m_pPeer = &peer;
+	pReq->m_bFluff = bFluff;
+	pReq->m_bValid = false;
+	pReq->m_hMin = get_ParentObj().m_Processor.m_Cursor.m_ID.m_Height + 1;
+
+	peer.m_TxPending++;
+
+	m_vBatch.push_back(pReq);
+	m_BatchOutputs += static_cast<uint32_t>(pReq->m_pTx->m_vOutputs.size());
+
+	const Config::TxBatch& cfg = get_ParentObj().m_Cfg.m_TxBatch;
+	if (!cfg.m_Window_ms || (m_BatchOutputs >= cfg.m_MaxOutputs))
+		Dispatch();
+	else
+	{
+		if (1 == m_vBatch.size())
+		{
+			if (!m_pTimer)
+				m_pTimer = io::Timer::create(io::Reactor::get_Current());
+
+			m_pTimer->start(cfg.m_Window_ms, false, [this]() { Dispatch(); });
+		}
+	}
+}
+
+void Node::TxAdmission::Dispatch()
+{
+	if (m_pTimer)
+		m_pTimer->cancel();
+
+	if (m_vBatch.empty())
+		return;
+
+	NodeProcessor::Task::Processor& tp = get_ParentObj().m_Processor.get_TaskProcessor();
+
+	// split the batch between the verification threads
+	size_t nTasks = std::min<size_t>(tp.get_Threads(), m_vBatch.size());
+	for (size_t iTask = 0, i0 = 0; iTask < nTasks; iTask++)
+	{
+		size_t i1 = m_vBatch.size() * (iTask + 1) / nTasks;
+
+		std::unique_ptr<MyTask> pTask(new MyTask);
+		pTask->m_pThis = this;
+		pTask->m_vReqs.assign(m_vBatch.begin() + i0, m_vBatch.begin() + i1);
+		i0 = i1;
+
+		tp.Push(std::move(pTask));
+	}
+
+	m_vBatch.clear();
+	m_BatchOutputs = 0;
+}
+
+void Node::TxAdmission::OnDone()
+{
+	while (true)
+	{
+		Request* pReq;
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			if (m_queDone.empty())
+				break;
+
+			pReq = m_queDone.front();
+			m_queDone.pop_front();
+		}
+
+		std::unique_ptr<Request> pGuard(pReq);
+		m_lstPending.erase(RequestList::s_iterator_to(*pReq));
+
+		if (pReq->m_pPeer)
+		{
+			assert(pReq->m_pPeer->m_TxPending);
+			pReq->m_pPeer->m_TxPending--;
+		}
+
+		get_ParentObj().OnTxVerified(*pReq);
+	}
+}
+
+void Node::TxAdmission::OnPeerDeleted(Peer& peer)
+{
+	for (RequestList::iterator it = m_lstPending.begin(); m_lstPending.end() != it; it++)
+		if (&peer == it->m_pPeer)
+			it->m_pPeer = nullptr;
+}
+
+void Node::TxAdmission::Clear()
+{
+	m_vBatch.clear();
+	m_BatchOutputs = 0;
+	m_queDone.clear();
+
+	while (!m_lstPending.empty())
+	{
+		Request& r = m_lstPending.front();
+		m_lstPending.pop_front();
+		delete &r;
+	}
+}
+
+bool Node::IsForkCrossed(Height h0, Height h1)
+{
+	const Rules& r = Rules::get();
+	for (size_t i = 1; i < _countof(r.pForks); i++)
+		if ((h0 >= r.pForks[i].m_Height) != (h1 >= r.pForks[i].m_Height))
+			return true;
+
+	return false;
+}
+
+void Node::OnTxVerified(TxAdmission::Request& r)
+{
+	// The tip may have moved while the tx was verified. If it crossed a fork - the rules are different, verify it again at the current height
+	bool bReverify = IsForkCrossed(r.m_hMin, m_Processor.m_Cursor.m_ID.m_Height + 1);
+	Transaction::Context* pCtx = bReverify ? nullptr : &r.m_Ctx;
+
+	if (r.m_bFluff)
+	{
+		if (r.m_bValid || bReverify)
+			OnTransactionFluff(std::move(r.m_pTx), r.m_pPeer, nullptr, pCtx);
+		else
+		{
+			TxPool::Fluff::Element::Tx key;
+			r.m_pTx->get_Key(key.m_Key);
+			LogTx(*r.m_pTx, proto::TxStatus::Invalid, key.m_Key);
+		}
+	}
+	else
+	{
+		uint8_t nCode = (r.m_bValid || bReverify) ?
+			OnTransactionStem(std::move(r.m_pTx), r.m_pPeer, pCtx) :
+			proto::TxStatus::Invalid;
+
+		if (r.m_pPeer)
+			r.m_pPeer->SendTxStatus(nCode);
+	}
+}
+
+uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx, bool bContextFree /* = true */)
+{
+	if (bContextFree && !(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
 		return proto::TxStatus::Invalid;
 
 	if (!m_Processor.ValidateTxContext(tx))
@@ -2085,7 +2491,28 @@ uint32_t Node::RandomUInt32(uint32_t threshold)
     return threshold;
 }
 
-uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
+bool Node::IsStemDup(const Transaction& tx)
+{
+	// The 1st stem element that shares a kernel with the tx decides. If it covers the tx, or the tx is reduced - no verification is needed
+	for (size_t i = 0; i < tx.m_vKernels.size(); i++)
+	{
+		TxPool::Stem::Element::Kernel key;
+		tx.m_vKernels[i]->get_ID(key.m_hv);
+
+		TxPool::Stem::KrnSet::iterator it = m_Dandelion.m_setKrns.find(key);
+		if (m_Dandelion.m_setKrns.end() == it)
+			continue;
+
+		bool bElemCovers = true, bNewCovers = true;
+		it->m_pThis->m_pValue->get_Reader().Compare(std::move(tx.get_Reader()), bElemCovers, bNewCovers);
+
+		return bElemCovers || !bNewCovers;
+	}
+
+	return false;
+}
+
+uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer, Transaction::Context* pCtxVerified /* = nullptr */)
 {
 	if (ptx->m_vInputs.empty() || ptx->m_vKernels.empty()) {
 		// stupid compiler insists on parentheses here!
@@ -2093,8 +2520,10 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 	}
 
 	Transaction::Context::Params pars;
-	Transaction::Context ctx(pars);
-	ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
+	Transaction::Context ctxLocal(pars);
+	Transaction::Context& ctx = pCtxVerified ? *pCtxVerified : ctxLocal;
+	if (!pCtxVerified)
+		ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
     bool bTested = false;
     TxPool::Stem::Element* pDup = NULL;
 
@@ -2129,7 +2558,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, !pCtxVerified);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 
@@ -2143,7 +2572,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
     {
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, !pCtxVerified);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 		}
@@ -2405,14 +2834,16 @@ Height Node::SampleDummySpentHeight()
 	return h;
 }
 
-bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem)
+bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem, Transaction::Context* pCtxVerified /* = nullptr */)
 {
     Transaction::Ptr ptx;
     ptx.swap(ptxArg);
 
 	Transaction::Context::Params pars;
-	Transaction::Context ctx(pars);
-	ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
+	Transaction::Context ctxLocal(pars);
+	Transaction::Context& ctx = pCtxVerified ? *pCtxVerified : ctxLocal;
+	if (!pCtxVerified)
+		ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
     if (pElem)
     {
         ctx.m_Fee = pElem->m_Profit.m_Fee;
@@ -2444,7 +2875,7 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
     m_Wtx.Delete(key.m_Key);
 
     // new transaction
-    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx);
+    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx, !pCtxVerified);
     LogTx(tx, nCode, key.m_Key);
 
 	if (proto::TxStatus::Ok != nCode) {
@@ -3673,7 +4104,7 @@ void Node::Miner::OnMined()
     assert(NodeProcessor::DataStatus::Accepted == eStatus);
 
     p.FlushDB();
-	p.TryGoUpAsync(); // will likely trigger OnNewState(), and spread this block to the network
+	p.TryGoUpDurable(); // will likely trigger OnNewState(), and spread this block to the network. But not before it's on disk, it may be lost on restart
 }
 
 struct Node::Beacon::OutCtx
@@ -73,11 +73,32 @@ struct Node
 
 		bool m_LogUtxos = false; // may be insecure. Off by default.
 
-		// Number of verification threads for CPU-hungry cryptography. Currently used for block validation only.
+		// Number of verification threads for CPU-hungry cryptography. Used for block and transaction validation.
 		// 0: single threaded
 		// negative: number of cores minus number of mining threads.
 		int m_VerificationThreads = 0;
 
+		// Number of threads for the peers' I/O: socket reads/writes, decryption and deserialization of the messages.
+		// The messages are still handled in the main thread. 0: everything is done in the main thread
+		uint32_t m_IoThreads = 0;
+
+		// Incoming transactions are verified on the verification threads. Txs from a peer beyond this limit are rejected until its pending ones are verified.
+		uint32_t m_MaxPendingTxsPerPeer = 64;
+
+		struct Compaction
+		{
+			// The DB space freed by pruning is reclaimed incrementally, in time slices, instead of the blocking vacuum
+			uint32_t m_Period_ms = 500;
+			uint32_t m_Budget_ms = 20; // per slice
+		} m_Compaction;
+
+		struct TxBatch
+		{
+			// Incoming txs are accumulated and verified in batches, range proofs of all the txs are checked at once.
+			uint32_t m_Window_ms = 20; // max delay before the batch is verified. Set to 0 to verify each tx immediately
+			uint32_t m_MaxOutputs = 512; // the batch is verified earlier once it has that many outputs
+		} m_TxBatch;
+
 		struct Bbs
 		{
 			uint32_t m_MessageTimeout_s = 3600 * 12; // 1/2 day
@@ -107,6 +128,8 @@ struct Node
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
 
+			size_t m_BodyCacheSize = 1024 * 1024 * 64; // recently served bodies, shared by the peers. Set to 0 to disable
+
 		} m_BandwidthCtl;
 
 		struct TestMode {
@@ -190,6 +213,7 @@ private:
 		void OnNewState() override;
 		void OnRolledBack() override;
 		void OnModified() override;
+		void OnPruned() override;
 		bool EnumViewerKeys(IKeyWalker&) override;
 		void OnUtxoEvent(const UtxoEvent::Value&) override;
 		void OnDummy(const Key::ID&, Height) override;
@@ -246,6 +270,16 @@ private:
 		void TryGoUpAsync();
 		void OnGoUpTimer();
 
+		uint64_t m_nGoUpCommitSeq = 0;
+		io::Timer::Ptr m_pDurableTimer;
+		void TryGoUpDurable(); // TryGoUpAsync() once the committed data is on disk (lazy commit mode)
+		void OnDurableTimer();
+
+		bool m_bCompactPending = false;
+		io::Timer::Ptr m_pCompactTimer;
+		void OnCompactTimer();
+		void ScheduleCompact();
+
 		std::deque<PeerID> m_lstInsanePeers;
 		io::AsyncEvent::Ptr m_pAsyncPeerInsane;
 		void FlushInsanePeers();
@@ -346,17 +380,105 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Dandelion)
 	} m_Dandelion;
 
-	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*);
+	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*, Transaction::Context* pCtxVerified = nullptr);
+	bool IsStemDup(const Transaction&);
 	void OnTransactionAggregated(Dandelion::Element&);
 	void PerformAggregation(Dandelion::Element&);
 	void AddDummyInputs(Transaction&);
 	void AddDummyOutputs(Transaction&);
 	Height SampleDummySpentHeight();
-	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*);
+	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*, Transaction::Context* pCtxVerified = nullptr);
 
-	uint8_t ValidateTx(Transaction::Context&, const Transaction&); // complete validation
+	uint8_t ValidateTx(Transaction::Context&, const Transaction&, bool bContextFree = true); // complete validation, unless the context-free part is already done
 	void LogTx(const Transaction&, uint8_t nStatus, const Transaction::KeyType&);
 
+	struct TxAdmission
+	{
+		// context-free tx validation is done on the verification threads, the rest is completed in the reactor thread
+		struct Request
+			:public boost::intrusive::list_base_hook<>
+		{
+			Transaction::Ptr m_pTx;
+			Peer* m_pPeer; // reset if the peer is deleted meanwhile
+			bool m_bFluff;
+			bool m_bValid;
+			Height m_hMin;
+			Transaction::Context::Params m_Pars;
+			Transaction::Context m_Ctx;
+
+			Request() :m_Ctx(m_Pars) {}
+		};
+
+		typedef boost::intrusive::list<Request> RequestList;
+		RequestList m_lstPending;
+
+		std::vector<Request*> m_vBatch; // accumulated, not dispatched yet
+		uint32_t m_BatchOutputs = 0;
+		io::Timer::Ptr m_pTimer;
+
+		std::mutex m_Mutex;
+		std::deque<Request*> m_queDone; // protected by m_Mutex
+		io::AsyncEvent::Ptr m_pEvtDone;
+
+		struct MyTask;
+
+		void Push(Transaction::Ptr&&, Peer&, bool bFluff);
+		void Dispatch();
+		void OnDone();
+		void OnPeerDeleted(Peer&);
+		void Clear(); // verification threads must be stopped
+
+		~TxAdmission() { Clear(); }
+
+		IMPLEMENT_GET_PARENT_OBJ(Node, m_TxAdmission)
+	} m_TxAdmission;
+
+	void OnTxVerified(TxAdmission::Request&);
+	static bool IsForkCrossed(Height h0, Height h1);
+
+	struct BodyCache
+	{
+		// Full block bodies recently sent to the peers. Syncing peers mostly request the same ranges,
+		// so they're served from here, without re-reading (and re-encoding) them.
+		struct Key
+		{
+			uint64_t m_Row;
+			Height m_Height0;
+			Height m_HorizonLo1;
+			uint8_t m_FlagP;
+			uint8_t m_FlagE;
+
+			bool operator < (const Key&) const;
+		};
+
+		struct Entry
+			:public boost::intrusive::set_base_hook<>
+			,public boost::intrusive::list_base_hook<>
+		{
+			Key m_Key;
+			std::shared_ptr<const proto::BodyBuffers> m_pBody;
+
+			bool operator < (const Entry& x) const { return m_Key < x.m_Key; }
+		};
+
+		typedef boost::intrusive::set<Entry> Set;
+		typedef boost::intrusive::list<Entry> List;
+
+		Set m_Set;
+		List m_List; // most recent at the back
+		size_t m_Size = 0;
+
+		~BodyCache() { Clear(); }
+
+		const std::shared_ptr<const proto::BodyBuffers>* Find(const Key&);
+		void Insert(const Key&, const std::shared_ptr<const proto::BodyBuffers>&, size_t nMaxSize);
+		void Delete(Entry&);
+		void Clear();
+
+		static size_t get_Size(const proto::BodyBuffers& x) { return x.m_Perishable.size() + x.m_Eternal.size(); }
+
+	} m_BodyCache;
+
 	struct Bbs
 	{
 		struct WantedMsg :public Wanted {
@@ -455,6 +577,7 @@ private:
 
 		uint64_t m_CursorBbs;
 		TxPool::Fluff::Element* m_pCursorTx;
+		uint32_t m_TxPending; // txs being verified
 
 		TaskList m_lstTasks;
 		std::set<Task::Key> m_setRejected; // data that shouldn't be requested from this peer. Reset after reconnection or on receiving NewTip
@@ -484,6 +607,7 @@ private:
 		void OnChocking();
 		void SetTxCursor(TxPool::Fluff::Element*);
 		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&);
+		bool GetBlockShared(std::shared_ptr<const proto::BodyBuffers>&, const NodeDB::StateID&, const proto::GetBodyPack&);
 
 		bool IsChocking(size_t nExtra = 0);
 		bool ShouldAssignTasks();
@@ -495,6 +619,7 @@ private:
 		void OnMsg(const proto::BbsMsg&, bool bNonceValid);
 
 		void SendTx(Transaction::Ptr& ptx, bool bFluff);
+		void SendTxStatus(uint8_t);
 
 		// proto::NodeConnection
 		virtual void OnConnectedSecure() override;
@@ -545,6 +670,8 @@ private:
 	typedef boost::intrusive::list<Peer> PeerList;
 	PeerList m_lstPeers;
 
+	std::unique_ptr<proto::IoThreads> m_pIoThreads;
+
 	ECC::NoLeak<ECC::uintBig> m_NonceLast;
 	const ECC::uintBig& NextNonce();
 	void NextNonce(ECC::Scalar::Native&);
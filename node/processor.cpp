@@ -19,6 +19,8 @@
 #include "../utility/logger.h"
 #include "../utility/logger_checkpoints.h"
 #include <condition_variable>
+#include <thread>
+#include <chrono>
 
 namespace grimm {
 
@@ -36,6 +38,210 @@ NodeProcessor::Horizon::Horizon()
 {
 }
 
+struct NodeProcessor::ReadPool
+{
+	std::string m_sPath;
+	std::vector<std::thread> m_vThreads;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NewJob;
+	std::deque<ReadJob::Ptr> m_queJobs; // protected by m_Mutex
+	bool m_Stop = false;
+
+	void Start(uint32_t nThreads)
+	{
+		m_vThreads.resize(nThreads);
+		for (uint32_t i = 0; i < nThreads; i++)
+			m_vThreads[i] = std::thread(&ReadPool::RunThread, this);
+	}
+
+	~ReadPool()
+	{
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_Stop = true;
+			m_NewJob.notify_all();
+		}
+
+		for (size_t i = 0; i < m_vThreads.size(); i++)
+			if (m_vThreads[i].joinable())
+				m_vThreads[i].join();
+	}
+
+	void RunThread()
+	{
+		NodeDB db;
+		try {
+			db.Open(m_sPath.c_str(), NodeDB::OpenMode::ReadOnly);
+		} catch (const std::exception& e) {
+			LOG_ERROR() << "DB reader open failed: " << e.what();
+			return;
+		}
+
+		while (true)
+		{
+			ReadJob::Ptr pJob;
+			{
+				std::unique_lock<std::mutex> scope(m_Mutex);
+				while (true)
+				{
+					if (m_Stop)
+						return;
+					if (!m_queJobs.empty())
+						break;
+					m_NewJob.wait(scope);
+				}
+
+				pJob = std::move(m_queJobs.front());
+				m_queJobs.pop_front();
+			}
+
+			bool bFailed = true;
+			for (uint32_t nAttempt = 0; ; nAttempt++)
+			{
+				try {
+					NodeDB::Transaction t(db); // the snapshot. Rolled back
+					pJob->Exec(db);
+					bFailed = false;
+				} catch (const NodeDBSegmentGoneException& e) {
+					// the writer deleted the body segment after our snapshot was taken. The newer snapshot doesn't reference it
+					if (nAttempt < 3)
+						continue;
+					LOG_ERROR() << "DB read job failed: " << e.what();
+				} catch (const CorruptionException& e) {
+					LOG_ERROR() << "DB read job failed: " << e.m_sErr;
+				} catch (const std::exception& e) {
+					LOG_ERROR() << "DB read job failed: " << e.what();
+				}
+				break;
+			}
+
+			if (bFailed)
+				pJob->OnFailed();
+		}
+	}
+};
+
+struct NodeProcessor::Durability
+{
+	// Lazy commit mode. The main thread commits without the WAL fsync (body segments are synced on commit), the WAL is synced and checkpointed here
+	std::string m_sPath;
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_NewJob;
+	std::condition_variable m_Synced;
+	uint64_t m_nPosted = 0;
+	uint64_t m_nSynced = 0; // commits that are on disk
+	uint64_t m_nDone = 0; // synced and checkpointed
+	bool m_Stop = false;
+	CommitStats m_Stats; // only the sync part is used
+
+	void Start()
+	{
+		m_Thread = std::thread(&Durability::RunThread, this);
+	}
+
+	~Durability()
+	{
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_Stop = true; // pending syncs are completed before the thread exits
+			m_NewJob.notify_one();
+		}
+
+		if (m_Thread.joinable())
+			m_Thread.join();
+	}
+
+	uint64_t Post()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		m_nPosted++;
+		m_NewJob.notify_one();
+		return m_nPosted;
+	}
+
+	void Wait()
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		for (uint64_t n = m_nPosted; m_nSynced < n; )
+			m_Synced.wait(scope);
+	}
+
+	void RunThread()
+	{
+		NodeDB db;
+		bool bOpen = true;
+		try {
+			db.Open(m_sPath.c_str(), NodeDB::OpenMode::Checkpoint);
+		} catch (const std::exception& e) {
+			LOG_ERROR() << "DB checkpoint handle open failed: " << e.what();
+			bOpen = false; // the WAL is still synced, but grows
+		}
+
+		std::string sWal = m_sPath + "-wal";
+		uint64_t nCheckpointed = 0;
+
+		while (true)
+		{
+			uint64_t nTarget;
+			{
+				std::unique_lock<std::mutex> scope(m_Mutex);
+				while (m_nDone == m_nPosted)
+				{
+					if (m_Stop)
+						return;
+					m_NewJob.wait(scope);
+				}
+
+				nTarget = m_nPosted;
+			}
+
+			auto t0 = std::chrono::steady_clock::now();
+			uint64_t nPages = 0;
+
+			try {
+				NodeDB::SyncFile(sWal.c_str());
+
+				{
+					// durable now, the checkpoint isn't waited for
+					std::unique_lock<std::mutex> scope(m_Mutex);
+					m_nSynced = nTarget;
+					m_Synced.notify_all();
+				}
+
+				if (bOpen)
+				{
+					// the WAL frame counter is reset when the WAL is restarted
+					uint64_t n = db.Checkpoint();
+					nPages = (n >= nCheckpointed) ? (n - nCheckpointed) : n;
+					nCheckpointed = n;
+				}
+			} catch (const CorruptionException& e) {
+				LOG_ERROR() << "DB sync failed: " << e.m_sErr;
+			} catch (const std::exception& e) {
+				LOG_ERROR() << "DB sync failed: " << e.what();
+			}
+
+			uint64_t dt_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_nDone = nTarget;
+			if (m_nSynced < nTarget)
+			{
+				m_nSynced = nTarget; // the sync failed, don't block the waiters forever
+				m_Synced.notify_all();
+			}
+
+			m_Stats.m_Syncs++;
+			m_Stats.m_SyncTime_us += dt_us;
+			m_Stats.m_SyncTimeMax_us = std::max(m_Stats.m_SyncTimeMax_us, dt_us);
+			m_Stats.m_PagesCheckpointed += nPages;
+		}
+	}
+};
+
 void NodeProcessor::Initialize(const char* szPath)
 {
 	StartParams sp; // defaults
@@ -44,7 +250,25 @@ void NodeProcessor::Initialize(const char* szPath)
 
 void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 {
-	m_DB.Open(szPath);
+	NodeDB::OpenMode::Enum eMode =
+		sp.m_LazyCommit ? NodeDB::OpenMode::WalLazy :
+		sp.m_ReadThreads ? NodeDB::OpenMode::Wal :
+		NodeDB::OpenMode::Exclusive;
+
+	m_DB.Open(szPath, eMode);
+
+	if (sp.m_LazyCommit)
+	{
+		m_pDurability.reset(new Durability);
+		m_pDurability->m_sPath = szPath;
+		m_pDurability->Start();
+	}
+
+	if (sp.m_UtxoSnapshot)
+	{
+		m_sPathUtxoSnapshot = szPath;
+		m_sPathUtxoSnapshot += ".utxo";
+	}
 	m_DbTx.Start(m_DB);
 
 	if (sp.m_CheckIntegrityAndVacuum)
@@ -54,6 +278,9 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 		Vacuum();
 	}
 
+	if (m_DB.ParamIntGetDef(NodeDB::ParamID::TxoProofsUpgrade))
+		MigrateTxoProofs();
+
 	Merkle::Hash hv;
 	Blob blob(hv);
 
@@ -134,10 +361,24 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 	InitializeUtxos();
 	m_Extra.m_Txos = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
 
+	RadixTree::SlabPool::Stats st;
+	ZeroObject(st);
+	m_Utxos.get_MemStats(st);
+	LOG_INFO() << "UTXO tree nodes: " << st.m_Nodes << ", allocated: " << (st.m_Bytes >> 10) << " KB";
+
 	OnHorizonChanged();
 
 	if (!sp.m_ResetCursor)
 		TryGoUp();
+
+	if (sp.m_ReadThreads)
+	{
+		CommitDB(); // make it visible to the readers
+
+		m_pReadPool.reset(new ReadPool);
+		m_pReadPool->m_sPath = szPath;
+		m_pReadPool->Start(sp.m_ReadThreads);
+	}
 }
 
 void NodeProcessor::LogSyncData()
@@ -159,16 +400,48 @@ void NodeProcessor::SaveSyncData()
 		m_DB.ParamSet(NodeDB::ParamID::SyncData, nullptr, nullptr);
 }
 
+NodeProcessor::NodeProcessor()
+{
+}
+
 NodeProcessor::~NodeProcessor()
 {
+	m_pReadPool.reset();
+
 	if (m_DbTx.IsInProgress())
 	{
 		try {
 			m_DbTx.Commit();
+			SaveUtxoSnapshot();
 		} catch (const CorruptionException& e) {
 			LOG_ERROR() << "DB Commit failed: %s" << e.m_sErr;
+		} catch (const std::exception& e) {
+			LOG_ERROR() << "UTXO snapshot save failed: " << e.what();
 		}
 	}
+
+	if (m_pDurability)
+	{
+		m_pDurability->Post();
+		m_pDurability->Wait();
+
+		CommitStats cs;
+		get_CommitStats(cs);
+		m_CommitStats = cs; // keep the sync part
+
+		m_pDurability.reset();
+	}
+
+	CommitStats cs;
+	get_CommitStats(cs);
+	if (cs.m_Commits)
+	{
+		LOG_INFO() << "DB commits: " << cs.m_Commits << ", avg " << cs.m_Time_us / cs.m_Commits << " us, max " << cs.m_TimeMax_us << " us, pages written: " << cs.m_PagesWritten;
+	}
+	if (cs.m_Syncs)
+	{
+		LOG_INFO() << "DB background syncs: " << cs.m_Syncs << ", avg " << cs.m_SyncTime_us / cs.m_Syncs << " us, max " << cs.m_SyncTimeMax_us << " us, pages checkpointed: " << cs.m_PagesCheckpointed;
+	}
 }
 
 void NodeProcessor::OnHorizonChanged()
@@ -177,8 +450,8 @@ void NodeProcessor::OnHorizonChanged()
 	m_Horizon.m_SchwarzschildHi = std::max(m_Horizon.m_SchwarzschildHi, (Height) Rules::get().Macroblock.MaxRollback);
 	m_Horizon.m_SchwarzschildLo = std::max(m_Horizon.m_SchwarzschildLo, m_Horizon.m_SchwarzschildHi);
 
-	if (PruneOld())
-		Vacuum();
+	if (PruneOld() && !m_DB.IsIncrementalVacuum())
+		Vacuum(); // the DB created by older versions. Converted by this, then compacted incrementally
 }
 
 void NodeProcessor::Vacuum()
@@ -190,6 +463,9 @@ void NodeProcessor::Vacuum()
 	m_DB.Vacuum();
 	LOG_INFO() << "DB compacting completed";
 
+	if (m_pDurability)
+		m_nCommitSeq = m_pDurability->Post();
+
 	m_DbTx.Start(m_DB);
 }
 
@@ -197,11 +473,93 @@ void NodeProcessor::CommitDB()
 {
 	if (m_DbTx.IsInProgress())
 	{
+		auto t0 = std::chrono::steady_clock::now();
 		m_DbTx.Commit();
+		uint64_t dt_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+		m_CommitStats.m_Commits++;
+		m_CommitStats.m_Time_us += dt_us;
+		m_CommitStats.m_TimeMax_us = std::max(m_CommitStats.m_TimeMax_us, dt_us);
+		m_CommitStats.m_PagesWritten = m_DB.get_PagesWritten();
+
+		if (m_pDurability)
+			m_nCommitSeq = m_pDurability->Post();
+
 		m_DbTx.Start(m_DB);
 	}
 }
 
+bool NodeProcessor::CompactStep(uint32_t nBudget_ms)
+{
+	uint32_t t0_ms = GetTime_ms();
+
+	// the Txo proofs side log: the segments kept by a few unspent proofs are rewritten
+	while (m_DB.TxoCompactProofs(m_iTxoCompact))
+		if (GetTime_ms() - t0_ms >= nBudget_ms)
+			return true;
+
+	if (!m_DB.IsIncrementalVacuum())
+		return false;
+
+	while (true)
+	{
+		uint64_t nPages = m_DB.get_FreePages();
+		if (!nPages)
+			return false;
+
+		m_DB.VacuumStep();
+
+		if (nPages <= NodeDB::s_VacuumStepPages)
+			return false;
+
+		if (GetTime_ms() - t0_ms >= nBudget_ms)
+			return true;
+	}
+}
+
+void NodeProcessor::WaitDurable()
+{
+	if (m_pDurability)
+		m_pDurability->Wait();
+}
+
+bool NodeProcessor::IsDurable(uint64_t nCommitSeq)
+{
+	if (!m_pDurability)
+		return true;
+
+	std::unique_lock<std::mutex> scope(m_pDurability->m_Mutex);
+	return m_pDurability->m_nSynced >= nCommitSeq;
+}
+
+void NodeProcessor::get_CommitStats(CommitStats& cs)
+{
+	cs = m_CommitStats;
+
+	if (m_pDurability)
+	{
+		std::unique_lock<std::mutex> scope(m_pDurability->m_Mutex);
+		const CommitStats& x = m_pDurability->m_Stats;
+
+		cs.m_Syncs = x.m_Syncs;
+		cs.m_SyncTime_us = x.m_SyncTime_us;
+		cs.m_SyncTimeMax_us = x.m_SyncTimeMax_us;
+		cs.m_PagesCheckpointed = x.m_PagesCheckpointed;
+	}
+}
+
+bool NodeProcessor::PostRead(ReadJob::Ptr& pJob)
+{
+	if (!m_pReadPool)
+		return false;
+
+	std::unique_lock<std::mutex> scope(m_pReadPool->m_Mutex);
+	m_pReadPool->m_queJobs.push_back(std::move(pJob));
+	m_pReadPool->m_NewJob.notify_one();
+
+	return true;
+}
+
 void NodeProcessor::InitCursor()
 {
 	if (m_DB.get_Cursor(m_Cursor.m_Sid))
@@ -543,6 +901,9 @@ struct NodeProcessor::MultiblockContext
 	{
 		m_This.get_TaskProcessor().Flush(0);
 
+		if (m_Prefetch.m_Blocks > 1)
+			LOG_INFO() << "Blocks prefetched: " << m_Prefetch.m_Blocks << ", stalls: " << m_Prefetch.m_Stalls;
+
 		if (m_bBatchDirty)
 		{
 			// make sure we don't leave batch context is an invalid state
@@ -616,6 +977,126 @@ struct NodeProcessor::MultiblockContext
 		uint32_t m_iVerifier;
 	};
 
+	struct Prefetch
+	{
+		// Block bodies ahead of the cursor are read from the DB, and deserialized on the verification threads,
+		// while the current block is being applied.
+		struct Entry
+		{
+			typedef std::shared_ptr<Entry> Ptr;
+
+			uint64_t m_Row;
+			MyTask::SharedBlock::Ptr m_pBlock;
+			ByteBuffer m_bbP;
+			ByteBuffer m_bbE;
+			size_t m_Size;
+			std::vector<Merkle::Hash> m_vKrnID;
+			bool m_bValid = false;
+
+			static const uint8_t s_Pending = 0;
+			static const uint8_t s_Busy = 1;
+			static const uint8_t s_Done = 2;
+			uint8_t m_State = s_Pending; // protected by Prefetch::m_Mutex
+
+			void Exec(); // deserialize, calculate kernel IDs
+		};
+
+		struct DeserializeTask
+			:public Task
+		{
+			Prefetch* m_pThis;
+			Entry::Ptr m_pEntry;
+
+			virtual void Exec() override;
+		};
+
+		const std::vector<uint64_t>* m_pPath = nullptr; // rows, in reverse order
+		size_t m_iPath = 0; // the lowest index that was prefetched
+
+		std::deque<Entry::Ptr> m_queEntries;
+		size_t m_Size = 0;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Cond;
+
+		uint32_t m_Blocks = 0;
+		uint32_t m_Stalls = 0; // had to wait for the verification thread
+
+		static const size_t s_SizeMax = 1024 * 1024 * 32;
+
+		bool TryExec(Entry&);
+	} m_Prefetch;
+
+	void SetPath(const std::vector<uint64_t>& vPath)
+	{
+		m_Prefetch.m_pPath = &vPath;
+		m_Prefetch.m_iPath = vPath.size();
+	}
+
+	void PrefetchBlocks()
+	{
+		Prefetch& pf = m_Prefetch;
+		if (!pf.m_pPath)
+			return;
+
+		while (pf.m_iPath && (pf.m_queEntries.size() < m_This.m_PrefetchBlocks) && (pf.m_Size < pf.s_SizeMax))
+		{
+			Prefetch::Entry::Ptr pEntry = CreateEntry((*pf.m_pPath)[--pf.m_iPath]);
+			pf.m_queEntries.push_back(pEntry);
+			pf.m_Size += pEntry->m_Size;
+
+			std::unique_ptr<Prefetch::DeserializeTask> pTask(new Prefetch::DeserializeTask);
+			pTask->m_pThis = &pf;
+			pTask->m_pEntry = std::move(pEntry);
+			m_This.get_TaskProcessor().Push(std::move(pTask));
+		}
+	}
+
+	Prefetch::Entry::Ptr CreateEntry(uint64_t row)
+	{
+		Prefetch::Entry::Ptr pEntry = std::make_shared<Prefetch::Entry>();
+		pEntry->m_Row = row;
+		pEntry->m_pBlock = std::make_shared<MyTask::SharedBlock>(*this);
+
+		m_This.m_DB.GetStateBlock(row, &pEntry->m_bbP, &pEntry->m_bbE);
+		pEntry->m_Size = pEntry->m_bbP.size() + pEntry->m_bbE.size();
+
+		return pEntry;
+	}
+
+	Prefetch::Entry::Ptr TakeBlock(uint64_t row)
+	{
+		Prefetch& pf = m_Prefetch;
+		if (pf.m_queEntries.empty() || (pf.m_queEntries.front()->m_Row != row))
+		{
+			// not prefetched
+			Prefetch::Entry::Ptr pEntry = CreateEntry(row);
+			pEntry->Exec();
+			return pEntry;
+		}
+
+		Prefetch::Entry::Ptr pEntry = std::move(pf.m_queEntries.front());
+		pf.m_queEntries.pop_front();
+
+		assert(pf.m_Size >= pEntry->m_Size);
+		pf.m_Size -= pEntry->m_Size;
+		pf.m_Blocks++;
+
+		if (!pf.TryExec(*pEntry))
+		{
+			std::unique_lock<std::mutex> scope(pf.m_Mutex);
+			if (Prefetch::Entry::s_Done != pEntry->m_State)
+			{
+				pf.m_Stalls++;
+
+				while (Prefetch::Entry::s_Done != pEntry->m_State)
+					pf.m_Cond.wait(scope);
+			}
+		}
+
+		return pEntry;
+	}
+
 	bool Flush()
 	{
 		FlushInternal();
@@ -811,6 +1292,58 @@ void NodeProcessor::MultiblockContext::MyTask::Exec()
 	m_pShared->Exec(m_iVerifier);
 }
 
+void NodeProcessor::MultiblockContext::Prefetch::Entry::Exec()
+{
+	Block::Body& block = m_pBlock->m_Body;
+
+	try {
+		Deserializer der;
+		der.reset(m_bbP);
+		der & Cast::Down<Block::BodyBase>(block);
+		der & Cast::Down<TxVectors::Perishable>(block);
+
+		der.reset(m_bbE);
+		der & Cast::Down<TxVectors::Eternal>(block);
+
+		m_bValid = true;
+	}
+	catch (const std::exception&) {
+		return;
+	}
+
+	ByteBuffer().swap(m_bbP);
+	ByteBuffer().swap(m_bbE);
+
+	m_vKrnID.resize(block.m_vKernels.size()); // allocate mem for all kernel IDs, we need them for initial verification vs header, and at the end - to add to the kernel index.
+	// better to allocate the memory, then to calculate IDs twice
+	for (size_t i = 0; i < m_vKrnID.size(); i++)
+		block.m_vKernels[i]->get_ID(m_vKrnID[i]);
+}
+
+bool NodeProcessor::MultiblockContext::Prefetch::TryExec(Entry& x)
+{
+	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		if (Entry::s_Pending != x.m_State)
+			return false;
+
+		x.m_State = Entry::s_Busy;
+	}
+
+	x.Exec();
+
+	std::unique_lock<std::mutex> scope(m_Mutex);
+	x.m_State = Entry::s_Done;
+	m_Cond.notify_all();
+
+	return true;
+}
+
+void NodeProcessor::MultiblockContext::Prefetch::DeserializeTask::Exec()
+{
+	m_pThis->TryExec(*m_pEntry); // may already be taken by the main thread
+}
+
 void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerifier)
 {
 	TxBase::Context ctx(m_Ctx.m_Params);
@@ -905,6 +1438,7 @@ void NodeProcessor::TryGoUp()
 		RollbackTo(sidTrg.m_Height);
 
 		MultiblockContext mbc(*this);
+		mbc.SetPath(vPath);
 		bool bContextFail = false;
 
 		for (size_t i = vPath.size(); i--; )
@@ -913,6 +1447,8 @@ void NodeProcessor::TryGoUp()
 			sidFwd.m_Height = m_Cursor.m_Sid.m_Height + 1;
 			sidFwd.m_Row = vPath[i];
 
+			mbc.PrefetchBlocks();
+
 			if (!HandleBlock(sidFwd, mbc))
 			{
 				bContextFail = mbc.m_bFail = true;
@@ -1116,6 +1652,9 @@ Height NodeProcessor::PruneOld()
 			hRet += RaiseTxoHi(h - m_Horizon.m_SchwarzschildHi);
 	}
 
+	if (hRet)
+		OnPruned();
+
 	return hRet;
 }
 
@@ -1170,27 +1709,45 @@ Height NodeProcessor::RaiseTxoHi(Height hTrg)
 	if (hTrg <= m_Extra.m_TxoHi)
 		return 0;
 
-	Height hRet = 0;
+	HeightRange hr(m_Extra.m_TxoHi + 1, hTrg);
+
+	// the proofs are in the side log, they're dropped in bulk. The table keeps only the naked values
+	Height hRet = m_DB.DeleteSpentTxoProofs(hr, 0);
+	if (hRet)
+		m_iTxoCompact = 0; // recheck the segments on the next CompactStep()
+
+	m_Extra.m_TxoHi = hTrg;
+	m_DB.ParamSet(NodeDB::ParamID::HeightTxoHi, &m_Extra.m_TxoHi, NULL);
+
+	return hRet;
+}
+
+void NodeProcessor::MigrateTxoProofs()
+{
+	// older versions kept the full values in the Txo table. Move them to the side log, once
+	LOG_INFO() << "Moving Txo proofs out of the DB...";
 
 	NodeDB::WalkerTxo wlk(m_DB);
-	for (m_DB.EnumTxosBySpent(wlk, HeightRange(m_Extra.m_TxoHi + 1, hTrg)); wlk.MoveNext(); )
-	{
-		assert(wlk.m_SpendHeight <= hTrg);
+	wlk.m_bNaked = true;
 
+	uint64_t nMoved = 0;
+	for (m_DB.EnumTxos(wlk, 0); wlk.MoveNext(); )
+	{
 		if (TxoIsNaked(wlk.m_Value))
 			continue;
 
 		uint8_t pNaked[s_TxoNakedMax];
-		TxoToNaked(pNaked, wlk.m_Value);
+		Blob valNaked = wlk.m_Value;
+		TxoToNaked(pNaked, valNaked);
 
-		m_DB.TxoSetValue(wlk.m_ID, wlk.m_Value);
-		hRet++;
+		m_DB.TxoMoveProof(wlk.m_ID, valNaked, wlk.m_Value);
+		nMoved++;
 	}
 
-	m_Extra.m_TxoHi = hTrg;
-	m_DB.ParamSet(NodeDB::ParamID::HeightTxoHi, &m_Extra.m_TxoHi, NULL);
+	m_DB.TxoFlushProofs();
+	m_DB.ParamSet(NodeDB::ParamID::TxoProofsUpgrade, nullptr, nullptr);
 
-	return hRet;
+	LOG_INFO() << "Txo proofs moved: " << nMoved;
 }
 
 void NodeProcessor::TxoToNaked(uint8_t* pBuf, Blob& v)
@@ -1232,6 +1789,21 @@ void NodeProcessor::TxoToNaked(uint8_t* pBuf, Blob& v)
 	v.n = static_cast<uint32_t>(sb.second);
 }
 
+void NodeProcessor::TxoAdd(TxoID id, const Blob& val)
+{
+	if (TxoIsNaked(val))
+	{
+		m_DB.TxoAdd(id, val, Blob(nullptr, 0));
+		return;
+	}
+
+	uint8_t pNaked[s_TxoNakedMax];
+	Blob valNaked = val;
+	TxoToNaked(pNaked, valNaked);
+
+	m_DB.TxoAdd(id, valNaked, val);
+}
+
 bool NodeProcessor::TxoIsNaked(const Blob& v)
 {
 	if (v.n < s_TxoNakedMin)
@@ -1243,8 +1815,79 @@ bool NodeProcessor::TxoIsNaked(const Blob& v)
 
 }
 
+void NodeProcessor::HashUtxosParallel()
+{
+	Task::Processor& tp = get_TaskProcessor();
+	uint32_t nThreads = tp.get_Threads();
+	if (!m_UtxoHashDepth || (nThreads < 2))
+		return;
+
+	struct Shared
+	{
+		UtxoTree* m_pTree;
+		UtxoTree::Subtrees m_Subtrees;
+		size_t m_iNext = 0;
+		size_t m_Done = 0;
+
+		std::mutex m_Mutex;
+		std::condition_variable m_Cond;
+
+		void Run()
+		{
+			// the tasks may start after all the work is done, hence they take what's left
+			std::unique_lock<std::mutex> scope(m_Mutex);
+
+			while (m_iNext < m_Subtrees.m_v.size())
+			{
+				size_t i = m_iNext++;
+				scope.unlock();
+
+				m_Subtrees.Hash(*m_pTree, i);
+
+				scope.lock();
+				if (++m_Done == m_Subtrees.m_v.size())
+					m_Cond.notify_one();
+			}
+		}
+	};
+
+	std::shared_ptr<Shared> pShared = std::make_shared<Shared>();
+	pShared->m_pTree = &m_Utxos;
+	pShared->m_Subtrees.Collect(m_Utxos, m_UtxoHashDepth);
+
+	size_t nCount = pShared->m_Subtrees.m_v.size();
+	if (nCount < 2)
+		return;
+
+	struct MyTask
+		:public Task
+	{
+		std::shared_ptr<Shared> m_pShared;
+
+		virtual void Exec() override
+		{
+			m_pShared->Run();
+		}
+	};
+
+	// don't Flush() the processor, it may have unrelated tasks in progress (block verification)
+	for (uint32_t i = 1; (i < nThreads) && (i < nCount); i++)
+	{
+		std::unique_ptr<MyTask> pTask(new MyTask);
+		pTask->m_pShared = pShared;
+		tp.Push(std::move(pTask));
+	}
+
+	pShared->Run();
+
+	std::unique_lock<std::mutex> scope(pShared->m_Mutex);
+	while (pShared->m_Done < nCount)
+		pShared->m_Cond.wait(scope);
+}
+
 void NodeProcessor::get_Definition(Merkle::Hash& hv, const Merkle::Hash& hvHist)
 {
+	HashUtxosParallel();
 	m_Utxos.get_Hash(hv);
 	Merkle::Interpret(hv, hvHist, false);
 }
@@ -1371,10 +2014,12 @@ bool NodeProcessor::HandleTreasury(const Blob& blob)
 			ser & *td.m_vGroups[iG].m_Data.m_vOutputs[i];
 
 			SerializeBuffer sb = ser.buffer();
-			m_DB.TxoAdd(id0, Blob(sb.first, static_cast<uint32_t>(sb.second)));
+			TxoAdd(id0, Blob(sb.first, static_cast<uint32_t>(sb.second)));
 		}
 	}
 
+	m_DB.TxoFlushProofs();
+
 	return true;
 }
 
@@ -1390,38 +2035,26 @@ std::ostream& operator << (std::ostream& s, const LogSid& sid)
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, MultiblockContext& mbc)
 {
-	ByteBuffer bbP, bbE;
-	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE);
+	MultiblockContext::Prefetch::Entry::Ptr pEntry = mbc.TakeBlock(sid.m_Row);
 
 	Block::SystemState::Full s;
 	m_DB.get_State(sid.m_Row, s); // need it for logging anyway
 
-	MultiblockContext::MyTask::SharedBlock::Ptr pShared = std::make_shared<MultiblockContext::MyTask::SharedBlock>(mbc);
+	MultiblockContext::MyTask::SharedBlock::Ptr pShared = std::move(pEntry->m_pBlock);
 	Block::Body& block = pShared->m_Body;
 
-	try {
-		Deserializer der;
-		der.reset(bbP);
-		der & Cast::Down<Block::BodyBase>(block);
-		der & Cast::Down<TxVectors::Perishable>(block);
-
-		der.reset(bbE);
-		der & Cast::Down<TxVectors::Eternal>(block);
-	}
-	catch (const std::exception&) {
+	if (!pEntry->m_bValid)
+	{
 		LOG_WARNING() << LogSid(m_DB, sid) << " Block deserialization failed";
 		return false;
 	}
 
-	std::vector<Merkle::Hash> vKrnID(block.m_vKernels.size()); // allocate mem for all kernel IDs, we need them for initial verification vs header, and at the end - to add to the kernel index.
-	// better to allocate the memory, then to calculate IDs twice
-	for (size_t i = 0; i < vKrnID.size(); i++)
-		block.m_vKernels[i]->get_ID(vKrnID[i]);
+	const std::vector<Merkle::Hash>& vKrnID = pEntry->m_vKrnID;
 
 	bool bFirstTime = (m_DB.get_StateTxos(sid.m_Row) == MaxHeight);
 	if (bFirstTime)
 	{
-		pShared->m_Size = bbP.size() + bbE.size();
+		pShared->m_Size = pEntry->m_Size;
 		pShared->m_Ctx.m_Height = sid.m_Height;
 
 		PeerID pid;
@@ -1514,7 +2147,7 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, MultiblockContext& m
 				if (!m_DB.get_Prev(row))
 					OnCorrupted();
 
-				AdjustOffset(offsAcc, row, true);
+				AdjustOffset(m_DB, offsAcc, row, true);
 			}
 
 			m_DB.set_StateExtra(sid.m_Row, &offsAcc);
@@ -1558,9 +2191,11 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, MultiblockContext& m
 			ser & *block.m_vOutputs[i];
 
 			SerializeBuffer sb = ser.buffer();
-			m_DB.TxoAdd(id0, Blob(sb.first, static_cast<uint32_t>(sb.second)));
+			TxoAdd(id0, Blob(sb.first, static_cast<uint32_t>(sb.second)));
 		}
 
+		m_DB.TxoFlushProofs(); // single write for the whole block
+
 		auto r = block.get_Reader();
 		r.Reset();
 		RecognizeUtxos(std::move(r), sid.m_Height);
@@ -1569,10 +2204,10 @@ bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, MultiblockContext& m
 	return bOk;
 }
 
-void NodeProcessor::AdjustOffset(ECC::Scalar& offs, uint64_t rowid, bool bAdd)
+void NodeProcessor::AdjustOffset(NodeDB& db, ECC::Scalar& offs, uint64_t rowid, bool bAdd)
 {
 	ECC::Scalar offsPrev;
-	if (!m_DB.get_StateExtra(rowid, offsPrev))
+	if (!db.get_StateExtra(rowid, offsPrev))
 		OnCorrupted();
 
 	ECC::Scalar::Native s(offsPrev);
@@ -1583,33 +2218,93 @@ void NodeProcessor::AdjustOffset(ECC::Scalar& offs, uint64_t rowid, bool bAdd)
 	offs = s;
 }
 
+static int CmpEventKey(const Blob& b, const NodeProcessor::UtxoEvent::Key& key)
+{
+	// same as sqlite blob comparison
+	int n = memcmp(b.p, &key, std::min<uint32_t>(b.n, sizeof(key)));
+	if (n)
+		return n;
+
+	return (b.n < sizeof(key)) ? -1 : (b.n > sizeof(key));
+}
+
 void NodeProcessor::RecognizeUtxos(TxBase::IReader&& r, Height hMax)
 {
-	NodeDB::WalkerEvent wlk(m_DB);
+	// Inputs are matched against a single cursor over the events, ordered by key. It's re-positioned only if it falls behind,
+	// hence inputs that are not ours are mostly skipped without querying the DB.
+	struct InputKey
+	{
+		UtxoEvent::Key m_Key;
+		Height m_Maturity;
+
+		bool operator < (const InputKey& x) const {
+			return memcmp(&m_Key, &x.m_Key, sizeof(m_Key)) < 0;
+		}
+	};
 
+	std::vector<InputKey> vIns;
 	for ( ; r.m_pUtxoIn; r.NextUtxoIn())
 	{
 		const Input& x = *r.m_pUtxoIn;
 		assert(x.m_Maturity); // must've already been validated
 
-		const UtxoEvent::Key& key = x.m_Commitment;
+		vIns.emplace_back();
+		vIns.back().m_Key = x.m_Commitment;
+		vIns.back().m_Maturity = x.m_Maturity;
+	}
+
+	std::sort(vIns.begin(), vIns.end()); // normally they're already sorted
+
+	std::vector<UtxoEvent::Value> vSpent;
+	std::vector<const UtxoEvent::Key*> vSpentKeys;
+
+	{
+		NodeDB::WalkerEvent wlk(m_DB);
+		bool bCursor = false;
+		bool bEnd = false;
 
-		m_DB.FindEvents(wlk, Blob(&key, sizeof(key))); // raw find (each time from scratch) is suboptimal, because inputs are sorted, should be a way to utilize this
-		if (wlk.MoveNext())
+		for (size_t i = 0; i < vIns.size(); i++)
 		{
+			const UtxoEvent::Key& key = vIns[i].m_Key;
+
+			if (bCursor && !bEnd && (CmpEventKey(wlk.m_Key, key) < 0))
+				bCursor = false;
+
+			if (!bCursor)
+			{
+				m_DB.FindEventsFrom(wlk, Blob(&key, sizeof(key)));
+				bEnd = !wlk.MoveNext();
+				bCursor = true;
+			}
+
+			if (bEnd)
+				break; // no more events
+
+			if (CmpEventKey(wlk.m_Key, key))
+				continue; // not ours
+
 			if (wlk.m_Body.n < sizeof(UtxoEvent::Value))
 				OnCorrupted();
 
-			UtxoEvent::Value evt = *reinterpret_cast<const UtxoEvent::Value*>(wlk.m_Body.p); // copy
-			evt.m_Maturity = x.m_Maturity;
-			evt.m_Added = 0;
+			vSpent.push_back(*reinterpret_cast<const UtxoEvent::Value*>(wlk.m_Body.p)); // copy
+			vSpentKeys.push_back(&key);
 
-			// In case of macroblock we can't recover the original input height.
-			m_DB.InsertEvent(hMax, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
-			OnUtxoEvent(evt);
+			UtxoEvent::Value& evt = vSpent.back();
+			evt.m_Maturity = vIns[i].m_Maturity;
+			evt.m_Added = 0;
 		}
 	}
 
+	for (size_t i = 0; i < vSpent.size(); i++)
+	{
+		const UtxoEvent::Value& evt = vSpent[i];
+		const UtxoEvent::Key& key = *vSpentKeys[i];
+
+		// In case of macroblock we can't recover the original input height.
+		m_DB.InsertEvent(hMax, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
+		OnUtxoEvent(evt);
+	}
+
 	for (; r.m_pUtxoOut; r.NextUtxoOut())
 	{
 		const Output& x = *r.m_pUtxoOut;
@@ -1650,56 +2345,200 @@ void NodeProcessor::RecognizeUtxos(TxBase::IReader&& r, Height hMax)
 	}
 }
 
-void NodeProcessor::RescanOwnedTxos()
+void NodeProcessor::RescanOwnedTxos(const Merkle::Hash* pTag /* = nullptr */)
 {
-	LOG_INFO() << "Rescanning owned Txos...";
+	TxoID id0 = 0;
+	if (pTag)
+	{
+		Merkle::Hash hv;
+		Blob blob(hv);
+		if (!m_DB.ParamGet(NodeDB::ParamID::RescanTxo, &id0, &blob) || (hv != *pTag) || (id0 > m_Extra.m_Txos))
+			id0 = 0;
+	}
 
-	m_DB.DeleteEventsFrom(Rules::HeightGenesis - 1);
+	if (id0)
+	{
+		LOG_INFO() << "Resuming owned Txos rescan from " << id0 << "/" << m_Extra.m_Txos;
+	}
+	else
+	{
+		LOG_INFO() << "Rescanning owned Txos...";
+		m_DB.DeleteEventsFrom(Rules::HeightGenesis - 1);
+	}
 
+	// Txos are read in chunks. The recovery attempts (the heavy part) are done in parallel, the results are saved serially.
 	struct TxoRecover
-		:public ITxoRecover
+		:public ITxoWalker
 	{
+		struct Entry
+		{
+			TxoID m_ID;
+			Height m_Create;
+			Height m_Spend;
+			Output m_Outp;
+			Key::IDV m_Kidv;
+			bool m_Recovered;
+		};
+
+		struct MyTask
+			:public Task
+		{
+			NodeProcessor* m_pThis;
+			std::unique_ptr<Entry>* m_ppE;
+			uint32_t m_Count;
+			uint32_t m_iVerifier;
+			uint32_t m_nVerifiers;
+
+			virtual void Exec() override
+			{
+				for (uint32_t i = m_iVerifier; i < m_Count; i += m_nVerifiers)
+				{
+					Entry& e = *m_ppE[i];
+					e.m_Recovered = m_pThis->Recover(e.m_Kidv, e.m_Outp, e.m_Create);
+				}
+			}
+		};
+
+		NodeProcessor& m_This;
+		const Merkle::Hash* m_pTag;
+		TxoID m_id0;
+		const uint32_t m_nChunk = 0x400;
+		std::vector<std::unique_ptr<Entry> > m_vChunk;
 		uint32_t m_Total = 0;
 		uint32_t m_Unspent = 0;
+		uint32_t m_Percent = 0;
 
-		TxoRecover(NodeProcessor& x) :ITxoRecover(x) {}
+		TxoRecover(NodeProcessor& x) :m_This(x) {}
 
-		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate, Output& outp, const Key::IDV& kidv) override
+		virtual bool OnTxo(const NodeDB::WalkerTxo& wlk, Height hCreate) override
 		{
-			if (IsDummy(kidv))
-			{
-				m_This.OnDummy(kidv, hCreate);
+			if (wlk.m_ID < m_id0)
+				return true; // already done
+
+			m_vChunk.emplace_back(new Entry);
+			Entry& e = *m_vChunk.back();
+			e.m_ID = wlk.m_ID;
+			e.m_Create = hCreate;
+			e.m_Spend = wlk.m_SpendHeight;
+
+			Deserializer der;
+			der.reset(wlk.m_Value.p, wlk.m_Value.n);
+			der & e.m_Outp;
+
+			if (m_vChunk.size() < m_nChunk)
 				return true;
+
+			// stop the walk, the chunk must be saved while the DB is not being enumerated
+			m_id0 = e.m_ID + 1;
+			return false;
+		}
+
+		void Flush()
+		{
+			if (m_vChunk.empty())
+				return;
+
+			Task::Processor& tp = m_This.get_TaskProcessor();
+			uint32_t nCount = static_cast<uint32_t>(m_vChunk.size());
+			uint32_t nVerifiers = std::min(tp.get_Threads(), nCount);
+
+			for (uint32_t i = 0; i < nVerifiers; i++)
+			{
+				std::unique_ptr<MyTask> pTask(new MyTask);
+				pTask->m_pThis = &m_This;
+				pTask->m_ppE = &m_vChunk.front();
+				pTask->m_Count = nCount;
+				pTask->m_iVerifier = i;
+				pTask->m_nVerifiers = nVerifiers;
+				tp.Push(std::move(pTask));
+			}
+
+			tp.Flush(0);
+
+			for (uint32_t i = 0; i < nCount; i++)
+			{
+				const Entry& e = *m_vChunk[i];
+				if (e.m_Recovered)
+					OnRecovered(e);
+			}
+
+			TxoID id1 = m_vChunk.back()->m_ID + 1;
+			m_vChunk.clear();
+
+			if (m_pTag)
+			{
+				// save the progress along with the events
+				Blob blob(*m_pTag);
+				m_This.get_DB().ParamSet(NodeDB::ParamID::RescanTxo, &id1, &blob);
+				m_This.CommitDB();
+			}
+
+			uint32_t nPercent = static_cast<uint32_t>(id1 * 100 / std::max<TxoID>(m_This.m_Extra.m_Txos, 1));
+			if (nPercent / 10 != m_Percent / 10)
+			{
+				m_Percent = nPercent;
+				LOG_INFO() << "Rescanning owned Txos " << nPercent << "%";
+			}
+		}
+
+		void OnRecovered(const Entry& e)
+		{
+			if (IsDummy(e.m_Kidv))
+			{
+				m_This.OnDummy(e.m_Kidv, e.m_Create);
+				return;
 			}
 
 			UtxoEvent::Value evt;
-			evt.m_Kidv = kidv;
-			evt.m_Maturity = outp.get_MinMaturity(hCreate);
+			evt.m_Kidv = e.m_Kidv;
+			evt.m_Maturity = e.m_Outp.get_MinMaturity(e.m_Create);
 			evt.m_Added = 1;
-			evt.m_AssetID = outp.m_AssetID;
+			evt.m_AssetID = e.m_Outp.m_AssetID;
 
-			const UtxoEvent::Key& key = outp.m_Commitment;
+			const UtxoEvent::Key& key = e.m_Outp.m_Commitment;
 
-			m_This.get_DB().InsertEvent(hCreate, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
+			m_This.get_DB().InsertEvent(e.m_Create, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
 			m_This.OnUtxoEvent(evt);
 
 			m_Total++;
 
-			if (MaxHeight == wlk.m_SpendHeight)
+			if (MaxHeight == e.m_Spend)
 				m_Unspent++;
 			else
 			{
 				evt.m_Added = 0;
-				m_This.get_DB().InsertEvent(wlk.m_SpendHeight, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
+				m_This.get_DB().InsertEvent(e.m_Spend, Blob(&evt, sizeof(evt)), Blob(&key, sizeof(key)));
 				m_This.OnUtxoEvent(evt);
 			}
-
-			return true;
 		}
 	};
 
 	TxoRecover wlk(*this);
-	EnumTxos(wlk);
+	wlk.m_pTag = pTag;
+	wlk.m_id0 = id0;
+	wlk.m_vChunk.reserve(wlk.m_nChunk);
+
+	while (true)
+	{
+		HeightRange hr(Rules::HeightGenesis - 1, m_Cursor.m_ID.m_Height);
+		if (wlk.m_id0 >= m_Extra.m_Txos)
+			hr.m_Min = hr.m_Max + 1; // nothing left
+		else if (wlk.m_id0 >= m_Extra.m_TxosTreasury)
+		{
+			NodeDB::StateID sid;
+			m_DB.FindStateByTxoID(sid, wlk.m_id0);
+			hr.m_Min = sid.m_Height;
+		}
+
+		bool bDone = EnumTxos(wlk, hr);
+		wlk.Flush();
+
+		if (bDone)
+			break;
+	}
+
+	if (pTag)
+		m_DB.ParamSet(NodeDB::ParamID::RescanTxo, nullptr, nullptr);
 
 	LOG_INFO() << "Recovered " << wlk.m_Unspent << "/" << wlk.m_Total << " unspent/total Txos";
 }
@@ -1932,6 +2771,8 @@ void NodeProcessor::RollbackTo(Height h)
 
 	// undo inputs
 	NodeDB::WalkerTxo wlk(m_DB);
+	wlk.m_bNaked = true;
+
 	for (m_DB.EnumTxosBySpent(wlk, HeightRange(h + 1, m_Cursor.m_Sid.m_Height)); wlk.MoveNext(); )
 	{
 		if (wlk.m_ID >= id0)
@@ -2013,11 +2854,11 @@ void NodeProcessor::RollbackTo(Height h)
 	m_Extra.m_Txos = id0;
 }
 
-NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id)
+NodeProcessor::DataStatus::Enum NodeProcessor::OnStateInternal(const Block::SystemState::Full& s, Block::SystemState::ID& id, bool bPoWChecked)
 {
 	s.get_ID(id);
 
-	if (!s.IsValid())
+	if (!s.IsSane() || !(bPoWChecked || s.IsValidPoW()))
 	{
 		LOG_WARNING() << id << " header invalid!";
 		return DataStatus::Invalid;
@@ -2056,9 +2897,9 @@ NodeProcessor::DataStatus::Enum NodeProcessor::OnState(const Block::SystemState:
 	return ret;
 }
 
-NodeProcessor::DataStatus::Enum NodeProcessor::OnStateSilent(const Block::SystemState::Full& s, const PeerID& peer, Block::SystemState::ID& id)
+NodeProcessor::DataStatus::Enum NodeProcessor::OnStateSilent(const Block::SystemState::Full& s, const PeerID& peer, Block::SystemState::ID& id, bool bPoWChecked)
 {
-	DataStatus::Enum ret = OnStateInternal(s, id);
+	DataStatus::Enum ret = OnStateInternal(s, id, bPoWChecked);
 	if (DataStatus::Accepted == ret)
 	{
 		uint64_t rowid = m_DB.InsertState(s);
@@ -2068,6 +2909,75 @@ NodeProcessor::DataStatus::Enum NodeProcessor::OnStateSilent(const Block::System
 	return ret;
 }
 
+uint32_t NodeProcessor::OnStatePack(const Block::SystemState::Full* pS, uint32_t nCount, const PeerID& peer, Block::SystemState::ID& idLast, bool& bInvalid)
+{
+	// PoW verification is context-free, and by far the heaviest part. Run it on all the verifiers
+	struct MyTask
+		:public Task
+	{
+		const Block::SystemState::Full* m_pS;
+		uint8_t* m_pPoW;
+		uint32_t m_Count;
+		uint32_t m_iVerifier;
+		uint32_t m_nVerifiers;
+
+		virtual void Exec() override
+		{
+			for (uint32_t i = m_iVerifier; i < m_Count; i += m_nVerifiers)
+				m_pPoW[i] = m_pS[i].IsValidPoW();
+		}
+	};
+
+	std::vector<uint8_t> vPoW(nCount);
+
+	Task::Processor& tp = get_TaskProcessor();
+	uint32_t nVerifiers = std::min(tp.get_Threads(), nCount);
+
+	for (uint32_t i = 0; i < nVerifiers; i++)
+	{
+		std::unique_ptr<MyTask> pTask(new MyTask);
+		pTask->m_pS = pS;
+		pTask->m_pPoW = &vPoW.front();
+		pTask->m_Count = nCount;
+		pTask->m_iVerifier = i;
+		pTask->m_nVerifiers = nVerifiers;
+		tp.Push(std::move(pTask));
+	}
+
+	tp.Flush(0);
+
+	// the rest must be done serially
+	uint32_t nAccepted = 0;
+
+	for (uint32_t i = 0; i < nCount; i++)
+	{
+		DataStatus::Enum eStatus;
+		if (vPoW[i])
+			eStatus = OnStateSilent(pS[i], peer, idLast, true);
+		else
+		{
+			pS[i].get_ID(idLast);
+			LOG_WARNING() << idLast << " header invalid!";
+			eStatus = DataStatus::Invalid;
+		}
+
+		switch (eStatus)
+		{
+		case DataStatus::Invalid:
+			bInvalid = true;
+			break;
+
+		case DataStatus::Accepted:
+			nAccepted++;
+
+		default:
+			break; // suppress warning
+		}
+	}
+
+	return nAccepted;
+}
+
 NodeProcessor::DataStatus::Enum NodeProcessor::OnBlock(const Block::SystemState::ID& id, const Blob& bbP, const Blob& bbE, const PeerID& peer)
 {
 	NodeDB::StateID sid;
@@ -2153,14 +3063,19 @@ bool NodeProcessor::IsRemoteTipNeeded(const Block::SystemState::Full& sTipRemote
 
 uint64_t NodeProcessor::FindActiveAtStrict(Height h)
 {
-	NodeDB::WalkerState ws(m_DB);
-	m_DB.EnumStatesAt(ws, h);
+	return FindActiveAtStrict(m_DB, h);
+}
+
+uint64_t NodeProcessor::FindActiveAtStrict(NodeDB& db, Height h)
+{
+	NodeDB::WalkerState ws(db);
+	db.EnumStatesAt(ws, h);
 	while (true)
 	{
 		if (!ws.MoveNext())
 			OnCorrupted();
 
-		if (NodeDB::StateFlags::Active & m_DB.GetStateFlags(ws.m_Sid.m_Row))
+		if (NodeDB::StateFlags::Active & db.GetStateFlags(ws.m_Sid.m_Row))
 			return ws.m_Sid.m_Row;
 	}
 }
@@ -2731,9 +3646,14 @@ bool NodeProcessor::VerifyBlock(const Block::BodyBase& block, TxBase::IReader&&
 }
 
 void NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::StateID& sid)
+{
+	ExtractBlockWithExtra(m_DB, block, sid);
+}
+
+void NodeProcessor::ExtractBlockWithExtra(NodeDB& db, Block::Body& block, const NodeDB::StateID& sid)
 {
 	ByteBuffer bbE;
-	m_DB.GetStateBlock(sid.m_Row, nullptr, &bbE);
+	db.GetStateBlock(sid.m_Row, nullptr, &bbE);
 
 	Deserializer der;
 	der.reset(bbE);
@@ -2743,23 +3663,25 @@ void NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::Stat
 		block.m_vKernels[i]->m_Maturity = sid.m_Height;
 
 	TxoID id0;
-	TxoID id1 = m_DB.get_StateTxos(sid.m_Row);
+	TxoID id1 = db.get_StateTxos(sid.m_Row);
 
-	if (!m_DB.get_StateExtra(sid.m_Row, block.m_Offset))
+	if (!db.get_StateExtra(sid.m_Row, block.m_Offset))
 		OnCorrupted();
 
 	uint64_t rowid = sid.m_Row;
-	if (m_DB.get_Prev(rowid))
+	if (db.get_Prev(rowid))
 	{
-		AdjustOffset(block.m_Offset, rowid, false);
-		id0 = m_DB.get_StateTxos(rowid);
+		AdjustOffset(db, block.m_Offset, rowid, false);
+		id0 = db.get_StateTxos(rowid);
 	}
 	else
 		id0 = m_Extra.m_TxosTreasury;
 
 	// inputs
-	NodeDB::WalkerTxo wlk(m_DB);
-	for (m_DB.EnumTxosBySpent(wlk, sid.m_Height); wlk.MoveNext(); )
+	NodeDB::WalkerTxo wlk(db);
+	wlk.m_bNaked = true;
+
+	for (db.EnumTxosBySpent(wlk, sid.m_Height); wlk.MoveNext(); )
 	{
 		assert(wlk.m_SpendHeight == sid.m_Height);
 
@@ -2772,7 +3694,7 @@ void NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::Stat
 		der & outp;
 
 		NodeDB::StateID sidPrev;
-		m_DB.FindStateByTxoID(sidPrev, wlk.m_ID); // relatively heavy operation: search for the original txo height
+		db.FindStateByTxoID(sidPrev, wlk.m_ID); // relatively heavy operation: search for the original txo height
 
 
 		block.m_vInputs.emplace_back();
@@ -2784,7 +3706,9 @@ void NodeProcessor::ExtractBlockWithExtra(Block::Body& block, const NodeDB::Stat
 	}
 
 	// outputs
-	for (m_DB.EnumTxos(wlk, id0); wlk.MoveNext(); )
+	wlk.m_bNaked = false;
+
+	for (db.EnumTxos(wlk, id0); wlk.MoveNext(); )
 	{
 		if (wlk.m_ID >= id1)
 			break;
@@ -2958,7 +3882,7 @@ bool NodeProcessor::ImportMacroBlockInternal(Block::BodyBase::IMacroReader& r)
 		if (id.m_Height >= Rules::HeightGenesis)
 			cmmr.Append(id.m_Hash);
 
-		switch (OnStateInternal(s, id))
+		switch (OnStateInternal(s, id, false))
 		{
 		case DataStatus::Invalid:
 		{
@@ -3126,6 +4050,8 @@ bool NodeProcessor::EnumTxos(ITxoWalker& wlkTxo, const HeightRange& hr)
 	Height h = hr.m_Min - 1; // don't care about overflow
 
 	NodeDB::WalkerTxo wlk(m_DB);
+	wlk.m_bNaked = wlkTxo.m_bNaked;
+
 	for (m_DB.EnumTxos(wlk, id1);  wlk.MoveNext(); )
 	{
 		if (wlk.m_ID >= id1)
@@ -3243,6 +4169,9 @@ void NodeProcessor::InitializeUtxos()
 		}
 	};
 
+	if (LoadUtxoSnapshot())
+		return;
+
 	Walker wlk(*this);
 	EnumTxos(wlk);
 
@@ -3256,6 +4185,88 @@ void NodeProcessor::InitializeUtxos()
 	}
 }
 
+struct UtxoSnapshotHdr
+{
+	static const uint32_t s_Version = 1;
+
+	uint32_t m_Version;
+	Block::SystemState::ID m_Cursor;
+
+	template <typename Archive>
+	void serialize(Archive& ar)
+	{
+		ar
+			& m_Version
+			& m_Cursor.m_Height
+			& m_Cursor.m_Hash.m_pData;
+	}
+};
+
+bool NodeProcessor::LoadUtxoSnapshot()
+{
+	if (m_sPathUtxoSnapshot.empty() || (m_Cursor.m_ID.m_Height < Rules::HeightGenesis))
+		return false;
+
+	std::FStream fs;
+	if (!fs.Open(m_sPathUtxoSnapshot.c_str(), true))
+		return false;
+
+	try
+	{
+		yas::binary_iarchive<std::FStream, SERIALIZE_OPTIONS> arc(fs);
+
+		UtxoSnapshotHdr hdr;
+		arc & hdr;
+
+		if ((UtxoSnapshotHdr::s_Version != hdr.m_Version) || (m_Cursor.m_ID != hdr.m_Cursor))
+		{
+			LOG_INFO() << "UTXO snapshot is outdated";
+			return false;
+		}
+
+		m_Utxos.load(arc);
+
+		// the snapshot is trusted only if it matches the current state definition
+		Merkle::Hash hv;
+		get_Definition(hv, false);
+		if (m_Cursor.m_Full.m_Definition == hv)
+		{
+			LOG_INFO() << "UTXOs loaded from snapshot";
+			m_bUtxosFromSnapshot = true;
+			return true;
+		}
+
+		LOG_WARNING() << "UTXO snapshot mismatch";
+	}
+	catch (const std::exception& e)
+	{
+		LOG_WARNING() << "UTXO snapshot load failed: " << e.what();
+	}
+
+	m_Utxos.Clear();
+	return false;
+}
+
+void NodeProcessor::SaveUtxoSnapshot()
+{
+	if (m_sPathUtxoSnapshot.empty() || (m_Cursor.m_ID.m_Height < Rules::HeightGenesis))
+		return;
+
+	std::FStream fs;
+	fs.Open(m_sPathUtxoSnapshot.c_str(), false, true);
+
+	yas::binary_oarchive<std::FStream, SERIALIZE_OPTIONS> arc(fs);
+
+	UtxoSnapshotHdr hdr;
+	hdr.m_Version = UtxoSnapshotHdr::s_Version;
+	hdr.m_Cursor = m_Cursor.m_ID;
+
+	arc & hdr;
+	m_Utxos.save(arc);
+
+	fs.Flush();
+}
+
 bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1)
 {
 	// h0 - current peer Height
@@ -3290,6 +4301,9 @@ bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal,
 	if (IsFastSync() && (sid.m_Height > m_Cursor.m_ID.m_Height))
 		return false;
 
+	if (!pPerishable && !pEthernal)
+		return true; // only the request is validated, the body is already known to the caller
+
 	bool bFullBlock = (sid.m_Height >= hHi1);
 	m_DB.GetStateBlock(sid.m_Row, bFullBlock ? pPerishable : nullptr, pEthernal);
 
@@ -3313,7 +4327,7 @@ bool NodeProcessor::GetBlock(const NodeDB::StateID& sid, ByteBuffer* pEthernal,
 	uint64_t rowid = sid.m_Row;
 	if (m_DB.get_Prev(rowid))
 	{
-		AdjustOffset(txb.m_Offset, rowid, false);
+		AdjustOffset(m_DB, txb.m_Offset, rowid, false);
 		id0 = m_DB.get_StateTxos(rowid);
 	}
 	else
@@ -38,6 +38,10 @@ class NodeProcessor
 	size_t m_nSizeUtxoComission;
 
 	struct MultiblockContext;
+	struct ReadPool;
+	std::unique_ptr<ReadPool> m_pReadPool;
+	struct Durability;
+	std::unique_ptr<Durability> m_pDurability;
 
 	void RollbackTo(Height);
 	Height PruneOld();
@@ -46,6 +50,7 @@ class NodeProcessor
 	Height RaiseTxoHi(Height);
 	void Vacuum();
 	void InitializeUtxos();
+	bool LoadUtxoSnapshot();
 	void RequestDataInternal(const Block::SystemState::ID&, uint64_t row, bool bBlock, const NodeDB::StateID& sidTrg);
 
 	bool HandleTreasury(const Blob&);
@@ -69,12 +74,15 @@ class NodeProcessor
 	static bool TxoIsNaked(const Blob&);
 
 	TxoID get_TxosBefore(Height);
-	void AdjustOffset(ECC::Scalar&, uint64_t rowid, bool bAdd);
+	void TxoAdd(TxoID, const Blob&);
+	void MigrateTxoProofs();
+	static void AdjustOffset(NodeDB&, ECC::Scalar&, uint64_t rowid, bool bAdd);
 
 	void InitCursor();
 	static void OnCorrupted();
 	void get_Definition(Merkle::Hash&, bool bForNextState);
 	void get_Definition(Merkle::Hash&, const Merkle::Hash& hvHist);
+	void HashUtxosParallel();
 
 	typedef std::pair<int64_t, std::pair<int64_t, Difficulty::Raw> > THW; // Time-Height-Work. Time and Height are signed
 	Difficulty get_NextDifficulty();
@@ -115,11 +123,15 @@ public:
 		bool m_CheckIntegrityAndVacuum = false;
 		bool m_ResetSelfID = false;
 		bool m_EraseSelfID = false;
+		bool m_UtxoSnapshot = false; // keep the UTXO set snapshot file beside the DB, to avoid its rebuild on start
+		uint32_t m_ReadThreads = 0; // read-only DB handles that serve PostRead(). If non-zero the DB is opened in WAL mode
+		bool m_LazyCommit = false; // commits don't fsync, the data is synced by the background thread (WAL mode). See WaitDurable()
 	};
 
 	void Initialize(const char* szPath);
 	void Initialize(const char* szPath, const StartParams&);
 
+	NodeProcessor();
 	virtual ~NodeProcessor();
 
 	struct Horizon {
@@ -132,6 +144,9 @@ public:
 
 	} m_Horizon;
 
+	uint16_t m_UtxoHashDepth = 6; // dirty UTXO subtrees at this depth are hashed in parallel. 0 - serial only
+	uint32_t m_PrefetchBlocks = 8; // block bodies ahead of the cursor deserialized in parallel during the sync. 0 - disabled
+
 	void OnHorizonChanged();
 
 	struct Cursor
@@ -174,6 +189,7 @@ public:
 
 	// Export compressed history elements. Suitable only for "small" ranges, otherwise may be both time & memory consumng.
 	void ExtractBlockWithExtra(Block::Body&, const NodeDB::StateID&);
+	void ExtractBlockWithExtra(NodeDB&, Block::Body&, const NodeDB::StateID&); // can be used by read jobs
 	void ExportMacroBlock(Block::BodyBase::IMacroWriter&, const HeightRange&);
 	void ExportHdrRange(const HeightRange&, Block::SystemState::Sequence::Prefix&, std::vector<Block::SystemState::Sequence::Element>&);
 	bool ImportMacroBlock(Block::BodyBase::IMacroReader&);
@@ -190,7 +206,9 @@ public:
 	bool IsTreasuryHandled() const { return m_Extra.m_TxosTreasury > 0; }
 
 	DataStatus::Enum OnState(const Block::SystemState::Full&, const PeerID&);
-	DataStatus::Enum OnStateSilent(const Block::SystemState::Full&, const PeerID&, Block::SystemState::ID&);
+	DataStatus::Enum OnStateSilent(const Block::SystemState::Full&, const PeerID&, Block::SystemState::ID&, bool bPoWChecked = false);
+	// Header pack import. PoW of all the elements is verified in parallel, then they're inserted serially. Returns num of accepted headers
+	uint32_t OnStatePack(const Block::SystemState::Full*, uint32_t nCount, const PeerID&, Block::SystemState::ID& idLast, bool& bInvalid);
 	DataStatus::Enum OnBlock(const Block::SystemState::ID&, const Blob& bbP, const Blob& bbE, const PeerID&);
 	DataStatus::Enum OnBlock(const NodeDB::StateID&, const Blob& bbP, const Blob& bbE, const PeerID&);
 	DataStatus::Enum OnTreasury(const Blob&);
@@ -201,7 +219,42 @@ public:
 
 	Height get_ProofKernel(Merkle::Proof&, TxKernel::Ptr*, const Merkle::Hash& idKrn);
 
+	// Read-only queries, executed by the reader threads concurrently with the block processing.
+	// Each job sees the last committed state of the DB, which may lag behind the main thread.
+	struct ReadJob
+	{
+		typedef std::unique_ptr<ReadJob> Ptr;
+		virtual void Exec(NodeDB&) = 0; // in a reader thread, within a read transaction. May be re-run with a newer snapshot if a body segment was deleted meanwhile
+		virtual void OnFailed() {} // in a reader thread, Exec has thrown and won't be re-run. The job should report the failure to its owner
+		virtual ~ReadJob() {}
+	};
+
+	bool PostRead(ReadJob::Ptr&); // if there're no readers - returns false and doesn't take the job. The caller should use get_DB() then
+
 	void CommitDB();
+	bool CompactStep(uint32_t nBudget_ms); // incremental DB compaction, within the time budget. Returns true if there's more to do
+	void WaitDurable(); // blocks until all the committed data is on disk. Commits are durable already unless in the lazy mode
+	uint64_t m_nCommitSeq = 0; // the last commit, lazy mode
+	bool IsDurable(uint64_t nCommitSeq); // non-blocking, the WAL is synced up to this commit
+
+	struct CommitStats
+	{
+		uint64_t m_Commits = 0;
+		uint64_t m_Time_us = 0; // total, on the caller thread
+		uint64_t m_TimeMax_us = 0;
+		uint64_t m_PagesWritten = 0;
+		// background syncs, lazy mode
+		uint64_t m_Syncs = 0;
+		uint64_t m_SyncTime_us = 0;
+		uint64_t m_SyncTimeMax_us = 0;
+		uint64_t m_PagesCheckpointed = 0;
+	};
+
+	void get_CommitStats(CommitStats&);
+
+	std::string m_sPathUtxoSnapshot; // empty if disabled
+	bool m_bUtxosFromSnapshot = false; // set on start if the UTXOs were loaded from the snapshot, i.e. not rebuilt from the Txo table
+	void SaveUtxoSnapshot(); // should be called when the DB is committed
 
 	void EnumCongestions();
 	const uint64_t* get_CachedRows(const NodeDB::StateID&, Height nCountExtra); // retval valid till next call to this func, or to EnumCongestions()
@@ -214,6 +267,7 @@ public:
 	virtual void OnNewState() {}
 	virtual void OnRolledBack() {}
 	virtual void OnModified() {}
+	virtual void OnPruned() {} // old data is deleted, CompactStep() should be called to reclaim the space
 
 	// parallel context-free execution
 	struct Task
@@ -244,9 +298,10 @@ public:
 
 	bool Recover(Key::IDV&, const Output&, Height hMax);
 
-	void RescanOwnedTxos();
+	void RescanOwnedTxos(const Merkle::Hash* pTag = nullptr); // with the tag the progress is saved, and the interrupted rescan is resumed
 
 	uint64_t FindActiveAtStrict(Height);
+	static uint64_t FindActiveAtStrict(NodeDB&, Height);
 
 	bool ValidateTxContext(const Transaction&); // assuming context-free validation is already performed, but 
 	bool ValidateTxWrtHeight(const Transaction&);
@@ -288,6 +343,8 @@ public:
 
 	struct ITxoWalker
 	{
+		bool m_bNaked = false; // set if only the naked values (commitment, maturity) are needed, the proofs aren't read then
+
 		// override at least one of those
 		virtual bool OnTxo(const NodeDB::WalkerTxo&, Height hCreate);
 		virtual bool OnTxo(const NodeDB::WalkerTxo&, Height hCreate, Output&);
@@ -309,6 +366,7 @@ public:
 	struct ITxoWalker_UnspentNaked
 		:public ITxoWalker
 	{
+		ITxoWalker_UnspentNaked() { m_bNaked = true; }
 		virtual bool OnTxo(const NodeDB::WalkerTxo&, Height hCreate) override;
 	};
 
@@ -333,9 +391,12 @@ public:
 	static bool IsDummy(const Key::IDV&);
 
 private:
+	CommitStats m_CommitStats;
+	uint32_t m_iTxoCompact = 0; // the next side log segment to check. Reset when the spent proofs are deleted
+
 	size_t GenerateNewBlockInternal(BlockContext&);
 	void GenerateNewHdr(BlockContext&);
-	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&);
+	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bPoWChecked);
 };
 
 struct LogSid
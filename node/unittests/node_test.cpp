@@ -291,12 +291,19 @@ namespace grimm
 
 		ByteBuffer bbBodyP, bbBodyE;
 		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE);
+		verify_test((bbBodyP.size() == bBodyP.n) && !memcmp(&bbBodyP.front(), bBodyP.p, bBodyP.n));
+		verify_test((bbBodyE.size() == bBodyE.n) && !memcmp(&bbBodyE.front(), bBodyE.p, bBodyE.n));
 
-		//db.DelStateBlockPP(pRows[0]);
-		//db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE);
+		db.DelStateBlockPP(pRows[0]);
+		bbBodyP.clear();
+		bbBodyE.clear();
+		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE);
+		verify_test(bbBodyP.empty() && (bbBodyE.size() == bBodyE.n));
 
 		db.DelStateBlockAll(pRows[0]);
+		bbBodyE.clear();
 		db.GetStateBlock(pRows[0], &bbBodyP, &bbBodyE);
+		verify_test(bbBodyP.empty() && bbBodyE.empty());
 
 		tr.Commit();
 		tr.Start(db);
@@ -535,6 +542,66 @@ namespace grimm
 		db.DeleteKernel(bBodyP, 5);
 		verify_test(db.FindKernel(bBodyP) == 0);
 
+		// Kernels with the standard IDs, the hits are cached
+		Merkle::Hash pKrn[0x20];
+		for (uint32_t i = 0; i < _countof(pKrn); i++)
+		{
+			ECC::Hash::Processor() << i >> pKrn[i];
+			if (i & 1)
+				db.InsertKernel(pKrn[i], 10 + i);
+		}
+
+		for (uint32_t i = 0; i < _countof(pKrn); i++)
+		{
+			verify_test(db.FindKernel(pKrn[i]) == ((i & 1) ? 10 + i : 0));
+			verify_test(db.FindKernel(pKrn[i]) == ((i & 1) ? 10 + i : 0)); // cached
+		}
+
+		db.InsertKernel(pKrn[1], 50);
+		verify_test(db.FindKernel(pKrn[1]) == 50);
+		db.DeleteKernel(pKrn[1], 50);
+		verify_test(db.FindKernel(pKrn[1]) == 11);
+		db.DeleteKernel(pKrn[1], 11);
+		verify_test(db.FindKernel(pKrn[1]) == 0);
+
+		for (uint32_t i = 3; i < _countof(pKrn); i += 2)
+			db.DeleteKernel(pKrn[i], 10 + i);
+
+		// Txos. Full values are kept in the side log
+		Blob bNaked("naked", 5);
+
+		auto fnEqual = [](const Blob& a, const Blob& b) {
+			return (a.n == b.n) && !memcmp(a.p, b.p, a.n);
+		};
+
+		for (TxoID id = 0; id < 4; id++)
+			db.TxoAdd(id, bNaked, (id & 1) ? bBodyP : Blob(nullptr, 0));
+
+		db.TxoSetSpent(1, 20);
+		db.TxoSetSpent(2, 20);
+
+		NodeDB::WalkerTxo wlkTxo(db);
+		for (db.EnumTxos(wlkTxo, 0); wlkTxo.MoveNext(); )
+			verify_test(fnEqual(wlkTxo.m_Value, (wlkTxo.m_ID & 1) ? bBodyP : bNaked));
+
+		wlkTxo.m_bNaked = true;
+		for (db.EnumTxos(wlkTxo, 0); wlkTxo.MoveNext(); )
+			verify_test(fnEqual(wlkTxo.m_Value, bNaked));
+
+		wlkTxo.m_bNaked = false;
+		verify_test(db.DeleteSpentTxoProofs(HeightRange(15, 25), 0) == 1);
+
+		db.TxoGetValue(wlkTxo, 1);
+		verify_test(fnEqual(wlkTxo.m_Value, bNaked));
+		db.TxoGetValue(wlkTxo, 3);
+		verify_test(fnEqual(wlkTxo.m_Value, bBodyP));
+
+		verify_test(db.DeleteSpentTxos(HeightRange(15, 25), 0) == 2);
+		db.TxoDelFrom(0);
+
+		db.EnumTxos(wlkTxo, 0);
+		verify_test(!wlkTxo.MoveNext());
+
 
 		tr.Commit();
 	}
@@ -556,6 +623,210 @@ namespace grimm
 		{
 			NodeDB db;
 			db.Open(g_sz); // test to open already-existing DB
+
+			// incremental compaction
+			verify_test(db.IsIncrementalVacuum());
+
+			NodeDB::Transaction tr(db);
+			for (uint32_t i = 0; i < 5000; i++)
+			{
+				Merkle::Hash hv;
+				ECC::Hash::Processor() << i >> hv;
+				db.InsertKernel(hv, 10);
+			}
+			tr.Commit();
+
+			tr.Start(db);
+			for (uint32_t i = 0; i < 5000; i++)
+			{
+				Merkle::Hash hv;
+				ECC::Hash::Processor() << i >> hv;
+				db.DeleteKernel(hv, 10);
+			}
+			tr.Commit();
+
+			tr.Start(db);
+			verify_test(db.get_FreePages() > 0);
+			while (db.get_FreePages())
+				db.VacuumStep();
+			tr.Commit();
+		}
+
+		uint64_t nSegTxo;
+		{
+			// Txo proofs side log, a segment kept by a single unspent proof
+			NodeDB db;
+			db.Open(g_sz);
+
+			Blob bNaked("naked", 5);
+			uint8_t pProof[1000];
+
+			NodeDB::Transaction tr(db);
+			for (TxoID id = 0; id < 10; id++)
+			{
+				memset(pProof, static_cast<uint8_t>(id), sizeof(pProof));
+				db.TxoAdd(id, bNaked, Blob(pProof, sizeof(pProof)));
+			}
+
+			for (TxoID id = 0; id < 9; id++)
+				db.TxoSetSpent(id, 20);
+			verify_test(db.DeleteSpentTxoProofs(HeightRange(15, 25), 0) == 9);
+
+			// as if the segment is full, the next proofs go to the new one
+			nSegTxo = db.ParamIntGetDef(NodeDB::ParamID::SegmentHiTxo);
+			uint64_t nHi = nSegTxo + 1;
+			db.ParamSet(NodeDB::ParamID::SegmentHiTxo, &nHi, NULL);
+			tr.Commit();
+		}
+
+		{
+			NodeDB db;
+			db.Open(g_sz);
+
+			std::string sPath = std::string(g_sz) + ".txo." + std::to_string(nSegTxo);
+			FILE* pFile = fopen(sPath.c_str(), "rb");
+			verify_test(pFile);
+			fclose(pFile);
+
+			NodeDB::Transaction tr(db);
+			uint32_t iSeg = 0;
+			while (db.TxoCompactProofs(iSeg))
+				;
+			verify_test(iSeg == nSegTxo + 1);
+			tr.Commit();
+
+			verify_test(!fopen(sPath.c_str(), "rb")); // deleted once committed
+
+			NodeDB::WalkerTxo wlkTxo(db);
+			db.TxoGetValue(wlkTxo, 9);
+			verify_test((wlkTxo.m_Value.n == 1000) && (reinterpret_cast<const uint8_t*>(wlkTxo.m_Value.p)[999] == 9));
+
+			// nothing left to move
+			iSeg = 0;
+			verify_test(!db.TxoCompactProofs(iSeg));
+
+			tr.Start(db);
+			db.TxoDelFrom(0);
+			tr.Commit();
+		}
+
+		{
+			// WAL mode. The reader sees the last committed state
+			NodeDB db;
+			db.Open(g_sz, NodeDB::OpenMode::Wal);
+
+			NodeDB dbR;
+			dbR.Open(g_sz, NodeDB::OpenMode::ReadOnly);
+
+			Block::SystemState::Full s;
+			ZeroObject(s);
+			s.m_Height = 1000;
+
+			NodeDB::Transaction tr(db);
+			uint64_t rowid = db.InsertState(s);
+			tr.Commit();
+
+			tr.Start(db);
+
+			Blob bBodyP("body", 4), bBodyE("abc", 3);
+			db.SetStateBlock(rowid, bBodyP, bBodyE);
+
+			ByteBuffer bbBodyP, bbBodyE;
+			{
+				NodeDB::Transaction trR(dbR);
+				dbR.GetStateBlock(rowid, &bbBodyP, &bbBodyE);
+				verify_test(bbBodyP.empty() && bbBodyE.empty());
+			}
+
+			tr.Commit();
+
+			NodeDB::Transaction trR(dbR);
+			dbR.GetStateBlock(rowid, &bbBodyP, &bbBodyE);
+			verify_test((bbBodyP.size() == bBodyP.n) && !memcmp(&bbBodyP.front(), bBodyP.p, bBodyP.n));
+			verify_test((bbBodyE.size() == bBodyE.n) && !memcmp(&bbBodyE.front(), bBodyE.p, bBodyE.n));
+		}
+
+		{
+			// Lazy commits. The written files are synced and checkpointed by another handle
+			NodeDB db;
+			db.Open(g_sz, NodeDB::OpenMode::WalLazy);
+
+			NodeDB dbC;
+			dbC.Open(g_sz, NodeDB::OpenMode::Checkpoint);
+
+			Block::SystemState::Full s;
+			ZeroObject(s);
+			s.m_Height = 1001;
+
+			NodeDB::Transaction tr(db);
+			uint64_t rowid = db.InsertState(s);
+
+			Blob bBodyP("lazy", 4), bBodyE("xyz", 3);
+			db.SetStateBlock(rowid, bBodyP, bBodyE);
+			tr.Commit(); // body segments are synced here, the WAL isn't
+
+			NodeDB::SyncFile((std::string(g_sz) + "-wal").c_str());
+			NodeDB::SyncFile((std::string(g_sz) + ".missing").c_str());
+
+			verify_test(dbC.Checkpoint() > 0);
+			verify_test(db.get_PagesWritten() > 0);
+
+			ByteBuffer bbBodyP, bbBodyE;
+			db.GetStateBlock(rowid, &bbBodyP, &bbBodyE);
+			verify_test((bbBodyP.size() == bBodyP.n) && !memcmp(&bbBodyP.front(), bBodyP.p, bBodyP.n));
+		}
+
+		{
+			// DB upgrade. Make it look like the version 17, with the block bodies in the States table
+			uint64_t rowid, nVerTop, nVer = 17;
+			{
+				NodeDB db;
+				db.Open(g_sz);
+				nVerTop = db.ParamIntGetDef(NodeDB::ParamID::DbVer);
+
+				Block::SystemState::Full s;
+				ZeroObject(s);
+				s.m_Height = 1002;
+
+				NodeDB::Transaction tr(db);
+				rowid = db.InsertState(s);
+				db.ParamSet(NodeDB::ParamID::DbVer, &nVer, NULL);
+				tr.Commit();
+			}
+
+			sqlite3* pDb = nullptr;
+			verify_test(SQLITE_OK == sqlite3_open(g_sz, &pDb));
+			std::string sql = "UPDATE States SET Perishable=x'6f6c6450',Ethernal=x'6f6c6445' WHERE rowid=" + std::to_string(rowid);
+			verify_test(SQLITE_OK == sqlite3_exec(pDb, sql.c_str(), NULL, NULL, NULL));
+			sqlite3_close(pDb);
+
+			{
+				NodeDB db;
+				db.Open(g_sz);
+				verify_test(db.ParamIntGetDef(NodeDB::ParamID::DbVer) == nVerTop);
+				verify_test(db.ParamIntGetDef(NodeDB::ParamID::TxoProofsUpgrade) != 0); // left for the processor
+
+				ByteBuffer bbBodyP, bbBodyE;
+				db.GetStateBlock(rowid, &bbBodyP, &bbBodyE);
+				verify_test((bbBodyP.size() == 4) && !memcmp(&bbBodyP.front(), "oldP", 4));
+				verify_test((bbBodyE.size() == 4) && !memcmp(&bbBodyE.front(), "oldE", 4));
+
+				// newer versions are rejected
+				nVer = nVerTop + 1;
+				NodeDB::Transaction tr(db);
+				db.ParamSet(NodeDB::ParamID::DbVer, &nVer, NULL);
+				tr.Commit();
+			}
+
+			bool bRejected = false;
+			try {
+				NodeDB db;
+				db.Open(g_sz);
+			}
+			catch (const NodeDBUpgradeException&) {
+				bRejected = true;
+			}
+			verify_test(bRejected);
 		}
 	}
 
@@ -962,6 +1233,95 @@ namespace grimm
 			}
 		}
 
+		{
+			// UTXO snapshot. The 1st run saves it on exit, the 2nd one should load it
+			NodeProcessor::StartParams sp;
+			sp.m_UtxoSnapshot = true;
+
+			Merkle::Hash hv0, hv1;
+			std::string sPathSnapshot;
+
+			{
+				NodeProcessor np;
+				np.m_Horizon = horz;
+				np.Initialize(g_sz, sp);
+				np.get_Utxos().get_Hash(hv0);
+				sPathSnapshot = np.m_sPathUtxoSnapshot;
+			}
+
+			{
+				NodeProcessor np;
+				np.m_Horizon = horz;
+				np.Initialize(g_sz, sp);
+				verify_test(np.m_bUtxosFromSnapshot);
+				np.get_Utxos().get_Hash(hv1);
+			}
+
+			verify_test(hv0 == hv1);
+
+			{
+				// full rebuild from the Txo table must give the same UTXO set
+				NodeProcessor np;
+				np.m_Horizon = horz;
+				np.Initialize(g_sz);
+				verify_test(!np.m_bUtxosFromSnapshot);
+				np.get_Utxos().get_Hash(hv1);
+			}
+
+			verify_test(hv0 == hv1);
+			verify_test(DeleteFile(sPathSnapshot.c_str()));
+		}
+
+		{
+			// Txo proofs upgrade. Put the full values back into the Txo table, as the older versions did
+			std::map<TxoID, ByteBuffer> mapFull;
+			{
+				NodeDB db;
+				db.Open(g_sz);
+
+				NodeDB::WalkerTxo wlk(db);
+				for (db.EnumTxos(wlk, 0); wlk.MoveNext(); )
+					wlk.m_Value.Export(mapFull[wlk.m_ID]);
+
+				NodeDB::Transaction tr(db);
+				for (auto it = mapFull.begin(); mapFull.end() != it; it++)
+					db.TxoSetValue(it->first, Blob(it->second));
+
+				uint64_t nUpgrade = 1;
+				db.ParamSet(NodeDB::ParamID::TxoProofsUpgrade, &nUpgrade, NULL);
+				tr.Commit();
+			}
+
+			{
+				NodeProcessor np;
+				np.m_Horizon = horz;
+				np.Initialize(g_sz);
+			}
+
+			NodeDB db;
+			db.Open(g_sz);
+			verify_test(!db.ParamIntGetDef(NodeDB::ParamID::TxoProofsUpgrade));
+
+			uint32_t nMoved = 0;
+			NodeDB::WalkerTxo wlk(db), wlkNaked(db);
+			wlkNaked.m_bNaked = true;
+			db.EnumTxos(wlk, 0);
+			db.EnumTxos(wlkNaked, 0);
+
+			for (auto it = mapFull.begin(); mapFull.end() != it; it++)
+			{
+				verify_test(wlk.MoveNext() && wlkNaked.MoveNext());
+				verify_test(wlk.m_ID == it->first);
+				verify_test((wlk.m_Value.n == it->second.size()) && !memcmp(wlk.m_Value.p, &it->second.front(), wlk.m_Value.n));
+
+				if (wlkNaked.m_Value.n < wlk.m_Value.n)
+					nMoved++;
+			}
+
+			verify_test(!wlk.MoveNext());
+			verify_test(nMoved > 0);
+		}
+
 		{
 			NodeProcessor np;
 			np.m_Horizon = horz;
@@ -1451,6 +1811,142 @@ namespace grimm
 
 
 
+	void TestNodeIoThreads()
+	{
+		// Node0 (miner) <-> Node1. Both serve the peers from the I/O threads: the accepted connection, and the outgoing one
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node, node2;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_Listen.port(g_Port);
+		node.m_Cfg.m_Listen.ip(INADDR_ANY);
+		node.m_Cfg.m_Treasury = g_Treasury;
+		node.m_Cfg.m_TestMode.m_FakePowSolveTime_ms = 10;
+		node.m_Cfg.m_MiningThreads = 1;
+		node.m_Cfg.m_IoThreads = 2;
+
+		node2.m_Cfg.m_sPathLocal = g_sz2;
+		node2.m_Cfg.m_Treasury = g_Treasury;
+		node2.m_Cfg.m_Connect.resize(1);
+		node2.m_Cfg.m_Connect[0].resolve("127.0.0.1");
+		node2.m_Cfg.m_Connect[0].port(g_Port);
+		node2.m_Cfg.m_IoThreads = 2;
+
+		ECC::SetRandom(node);
+		ECC::SetRandom(node2);
+
+		node.Initialize();
+		node2.Initialize();
+
+		NodeProcessor& np2 = node2.get_Processor();
+		const Height hTrg = 20;
+		uint32_t nCycles = 0;
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(100, true, [&]() {
+			if ((np2.m_Cursor.m_ID.m_Height >= hTrg) || (++nCycles > 600))
+				io::Reactor::get_Current().stop();
+		});
+
+		pReactor->run();
+
+		verify_test(np2.m_Cursor.m_ID.m_Height >= hTrg);
+	}
+
+	void TestNodeLazyCommit()
+	{
+		// Miner node in the lazy commit mode. The mined blocks are spread once the background sync is done
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_TestMode.m_FakePowSolveTime_ms = 10;
+		node.m_Cfg.m_MiningThreads = 1;
+		node.m_Cfg.m_Treasury = g_Treasury;
+		node.m_Cfg.m_ProcessorParams.m_LazyCommit = true;
+
+		ECC::SetRandom(node);
+
+		node.Initialize();
+
+		NodeProcessor& np = node.get_Processor();
+		const Height hTrg = 10;
+		uint32_t nCycles = 0;
+
+		io::Timer::Ptr pTimer = io::Timer::create(*pReactor);
+		pTimer->start(100, true, [&]() {
+			if ((np.m_Cursor.m_ID.m_Height >= hTrg) || (++nCycles > 600))
+				io::Reactor::get_Current().stop();
+		});
+
+		pReactor->run();
+
+		verify_test(np.m_Cursor.m_ID.m_Height >= hTrg);
+
+		np.CommitDB();
+		uint64_t nCommitSeq = np.m_nCommitSeq;
+		verify_test(nCommitSeq > 0);
+
+		np.WaitDurable();
+		verify_test(np.IsDurable(nCommitSeq));
+
+		NodeProcessor::CommitStats cs;
+		np.get_CommitStats(cs);
+		verify_test(cs.m_Syncs > 0);
+	}
+
+	void TestNodeReadJobs()
+	{
+		// a job that keeps hitting a deleted segment is re-run a few times, then it must be told it failed
+		struct MyJob
+			:public NodeProcessor::ReadJob
+		{
+			bool m_bFail;
+			std::atomic<uint32_t>* m_pRuns;
+			std::atomic<int>* m_pResult; // 1 = ok, -1 = failed
+
+			void Exec(NodeDB&) override
+			{
+				(*m_pRuns)++;
+				if (m_bFail)
+					throw NodeDBSegmentGoneException("segment gone");
+				*m_pResult = 1;
+			}
+
+			void OnFailed() override
+			{
+				*m_pResult = -1;
+			}
+		};
+
+		NodeProcessor np;
+		NodeProcessor::StartParams sp;
+		sp.m_ReadThreads = 1;
+		np.Initialize(g_sz, sp);
+
+		for (int i = 0; i < 2; i++)
+		{
+			std::atomic<uint32_t> nRuns(0);
+			std::atomic<int> nResult(0);
+
+			std::unique_ptr<MyJob> pJob(new MyJob);
+			pJob->m_bFail = !i;
+			pJob->m_pRuns = &nRuns;
+			pJob->m_pResult = &nResult;
+
+			NodeProcessor::ReadJob::Ptr pReadJob(std::move(pJob));
+			verify_test(np.PostRead(pReadJob));
+
+			for (uint32_t nCycles = 0; !nResult && (nCycles < 1000); nCycles++)
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+			verify_test(nResult == (i ? 1 : -1));
+			verify_test(nRuns == (i ? 1U : 4U));
+		}
+	}
+
 	void TestNodeClientProto()
 	{
 		// Testing configuration: Node <-> Client. Node is a miner
@@ -1493,6 +1989,8 @@ namespace grimm
 			uint32_t m_nChainWorkProofsPending = 0;
 			uint32_t m_nBbsMsgsPending = 0;
 			uint32_t m_nRecoveryPending = 0;
+			uint32_t m_nInvalidTxsSent = 0;
+			uint32_t m_nInvalidTxsPending = 0;
 			AssetID m_AssetEmitted = Zero;
 			bool m_bCustomAssetRecognized = false;
 
@@ -1709,6 +2207,9 @@ namespace grimm
 					ctx.m_Height.m_Min = msg.m_Description.m_Height + 1;
 					verify_test(msgTx.m_Transaction->IsValid(ctx));
 
+					if (m_nInvalidTxsSent < 3)
+						SendCorrupted(*msgTx.m_Transaction); // should be rejected, without affecting the valid one in the same batch
+
 					Send(msgTx);
 				}
 
@@ -1725,6 +2226,42 @@ namespace grimm
 
 			}
 
+			void SendCorrupted(const Transaction& tx)
+			{
+				Serializer ser;
+				ser & tx;
+
+				proto::NewTransaction msgTx;
+				msgTx.m_Transaction = std::make_shared<Transaction>();
+
+				Deserializer der;
+				der.reset(ser.buffer().first, ser.buffer().second);
+				der & *msgTx.m_Transaction;
+
+				for (size_t i = 0; i < msgTx.m_Transaction->m_vOutputs.size(); i++)
+				{
+					Output& outp = *msgTx.m_Transaction->m_vOutputs[i];
+					if (outp.m_pConfidential)
+					{
+						outp.m_pConfidential->m_Mu.m_Value.Inc();
+
+						Send(msgTx);
+						m_nInvalidTxsSent++;
+						m_nInvalidTxsPending++;
+						break;
+					}
+				}
+			}
+
+			virtual void OnMsg(proto::Status&& msg) override
+			{
+				if (proto::TxStatus::Invalid == msg.m_Value)
+				{
+					verify_test(m_nInvalidTxsPending);
+					m_nInvalidTxsPending--;
+				}
+			}
+
 			bool m_MiningFinalization = false;
 
 			virtual void SetupLogin(proto::Login& msg) override
@@ -1978,6 +2515,8 @@ namespace grimm
 			fail_test("some BBS messages missing");
 		if (!cl.IsAllRecoveryReceived())
 			fail_test("some recovery messages missing");
+		if (!cl.m_nInvalidTxsSent || cl.m_nInvalidTxsPending)
+			fail_test("invalid txs not rejected");
 		//if (!cl.m_bCustomAssetRecognized)
 		//	fail_test("CA not recognized");
 
@@ -2001,9 +2540,72 @@ namespace grimm
 		node.get_Processor().RescanOwnedTxos();
 
 		verify_test(wlk.m_Recovered);
+
+		struct
+		{
+			uint32_t operator () (NodeDB& db) const
+			{
+				uint32_t nEvents = 0;
+				NodeDB::WalkerEvent wlkEvt(db);
+				for (db.EnumEvents(wlkEvt, 0); wlkEvt.MoveNext(); )
+					nEvents++;
+				return nEvents;
+			}
+		} CountEvents;
+
+		NodeDB& db = node.get_Processor().get_DB();
+		uint32_t nEvents = CountEvents(db);
+		verify_test(nEvents);
+
+		// interrupted rescan is resumed only for the same tag
+		Merkle::Hash hvTag(Zero);
+		TxoID idNext = node.get_Processor().m_Extra.m_Txos;
+		Blob blob(hvTag);
+		db.ParamSet(NodeDB::ParamID::RescanTxo, &idNext, &blob);
+		db.DeleteEventsFrom(Rules::HeightGenesis + 1);
+
+		node.get_Processor().RescanOwnedTxos(&hvTag); // nothing left to rescan
+		verify_test(CountEvents(db) < nEvents);
+		verify_test(!db.ParamGet(NodeDB::ParamID::RescanTxo, nullptr, &blob));
+
+		hvTag.Inc();
+		node.get_Processor().RescanOwnedTxos(&hvTag);
+		verify_test(CountEvents(db) == nEvents);
 	}
 
 
+	void TestBodyPackRef()
+	{
+		// must be indistinguishable from BodyPack on the wire
+		proto::BodyPack msg;
+		proto::BodyPackRef msgRef;
+
+		for (uint32_t i = 0; i < 300; i++)
+		{
+			std::shared_ptr<proto::BodyBuffers> pBody = std::make_shared<proto::BodyBuffers>();
+			pBody->m_Perishable.assign(i * 7, static_cast<uint8_t>(i));
+			pBody->m_Eternal.assign(i % 5, static_cast<uint8_t>(~i));
+
+			msg.m_Bodies.push_back(*pBody);
+			msgRef.m_vBodies.push_back(std::move(pBody));
+		}
+
+		Serializer ser1, ser2;
+		ser1 & msg;
+		ser2 & msgRef;
+
+		SerializeBuffer sb1 = ser1.buffer();
+		SerializeBuffer sb2 = ser2.buffer();
+		verify_test((sb1.second == sb2.second) && !memcmp(sb1.first, sb2.first, sb1.second));
+
+		proto::BodyPack msg2;
+		Deserializer der;
+		der.reset(sb2.first, sb2.second);
+		der & msg2;
+		verify_test(msg2.m_Bodies.size() == msg.m_Bodies.size());
+		verify_test(msg2.m_Bodies.back().m_Perishable == msg.m_Bodies.back().m_Perishable);
+	}
+
 	void TestChainworkProof()
 	{
 		printf("Preparing blockchain ...\n");
@@ -2297,6 +2899,7 @@ int main()
 	grimm::PrepareTreasury();
 
 	grimm::TestHalving();
+	grimm::TestBodyPackRef();
 	grimm::TestChainworkProof();
 
 	// Make sure this test doesn't run in parallel. We have the following potential collisions for Nodes:
@@ -2351,6 +2954,25 @@ int main()
 	grimm::DeleteFile(grimm::g_sz);
 	grimm::DeleteFile(grimm::g_sz2);
 
+	printf("NodeX2 I/O threads test...\n");
+	fflush(stdout);
+
+	grimm::TestNodeIoThreads();
+	grimm::DeleteFile(grimm::g_sz);
+	grimm::DeleteFile(grimm::g_sz2);
+
+	printf("Node lazy commit test...\n");
+	fflush(stdout);
+
+	grimm::TestNodeLazyCommit();
+	grimm::DeleteFile(grimm::g_sz);
+
+	printf("Node read jobs test...\n");
+	fflush(stdout);
+
+	grimm::TestNodeReadJobs();
+	grimm::DeleteFile(grimm::g_sz);
+
 	printf("Node <---> FlyClient test...\n");
 	fflush(stdout);
 
@@ -49,6 +49,12 @@ public:
     /// Disables all messages
     void disable_all_msg_types() { _msgReader.disable_all_msg_types(); }
 
+    /// Holds the received messages after the current one, see MsgReader::suspend()
+    void suspend() { _msgReader.suspend(); }
+
+    /// Dispatches the held messages, returns false if the connection should stop (it may be deleted already)
+    bool resume() { return _msgReader.resume(); }
+
 private:
     MsgReader _msgReader;
 };
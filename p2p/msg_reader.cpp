@@ -15,9 +15,85 @@
 #include "msg_reader.h"
 #include <assert.h>
 #include <algorithm>
+#include <mutex>
 
 namespace grimm {
 
+namespace {
+
+/// Buffers for the messages that don't fit the readers' default buffers (i.e. block and header packs).
+/// Shared by all the connections. Sizes are rounded up to powers of 2, so that the buffers are reused
+/// for the messages of similar size. The classes cover the max protocol message, the total pooled size is bounded.
+class MsgBufferPool {
+public:
+    static MsgBufferPool& get() {
+        static MsgBufferPool s_pool;
+        return s_pool;
+    }
+
+    uint8_t* alloc(size_t size, size_t& capacity) {
+        unsigned sizeClass = MIN_CLASS;
+        while ((size_t(1) << sizeClass) < size) {
+            if (++sizeClass > MAX_CLASS) {
+                capacity = size; // not pooled, freed on release
+                return new uint8_t[size];
+            }
+        }
+
+        capacity = size_t(1) << sizeClass;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            std::vector<uint8_t*>& free = _free[sizeClass - MIN_CLASS];
+            if (!free.empty()) {
+                uint8_t* p = free.back();
+                free.pop_back();
+                _pooledBytes -= capacity;
+                return p;
+            }
+        }
+
+        return new uint8_t[capacity];
+    }
+
+    void release(uint8_t* p, size_t capacity) {
+        for (unsigned sizeClass = MIN_CLASS; sizeClass <= MAX_CLASS; sizeClass++) {
+            if ((size_t(1) << sizeClass) == capacity) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                std::vector<uint8_t*>& free = _free[sizeClass - MIN_CLASS];
+                // at least one buffer is kept for the classes above MAX_POOLED_PER_CLASS
+                if ((free.empty() || (free.size() * capacity < MAX_POOLED_PER_CLASS)) && (_pooledBytes + capacity <= MAX_POOLED_TOTAL)) {
+                    free.push_back(p);
+                    _pooledBytes += capacity;
+                    return;
+                }
+                break;
+            }
+        }
+
+        delete[] p;
+    }
+
+    ~MsgBufferPool() {
+        for (auto& free : _free) {
+            for (uint8_t* p : free) {
+                delete[] p;
+            }
+        }
+    }
+
+private:
+    static const unsigned MIN_CLASS = 12; // 4K
+    static const unsigned MAX_CLASS = 24; // 16M, the node protocol messages are up to 10M
+    static const size_t MAX_POOLED_PER_CLASS = 4 * 1024 * 1024;
+    static const size_t MAX_POOLED_TOTAL = 32 * 1024 * 1024; // across all the classes
+
+    std::mutex _mutex;
+    std::vector<uint8_t*> _free[MAX_CLASS - MIN_CLASS + 1];
+    size_t _pooledBytes = 0; // protected by _mutex
+};
+
+} //namespace
+
 MsgReader::MsgReader(ProtocolBase& protocol, uint64_t streamId, size_t defaultSize) :
     _protocol(protocol),
     _streamId(streamId),
@@ -30,7 +106,7 @@ MsgReader::MsgReader(ProtocolBase& protocol, uint64_t streamId, size_t defaultSi
 
     assert(_defaultSize >= MsgHeader::SIZE);
     _msgBuffer.resize(_defaultSize);
-    _cursor = _msgBuffer.data();
+    _buffer = _cursor = _msgBuffer.data();
 
     // by default, all message types are allowed
     enable_all_msg_types();
@@ -40,12 +116,26 @@ MsgReader::~MsgReader()
 {
 	if (_pAlive)
 		*_pAlive = false;
+
+    release_large_buffer();
 }
 
 void MsgReader::reset() {
     _bytesLeft = MsgHeader::SIZE;
     _state = reading_header;
-    _cursor = _msgBuffer.data();
+    release_large_buffer();
+    _cursor = _buffer;
+    _suspended = false;
+    _suspendedData.clear();
+}
+
+void MsgReader::release_large_buffer() {
+    if (_largeBuffer) {
+        MsgBufferPool::get().release(_largeBuffer, _largeCapacity);
+        _largeBuffer = nullptr;
+        _largeCapacity = 0;
+    }
+    _buffer = _msgBuffer.data();
 }
 
 void MsgReader::change_id(uint64_t newStreamId) {
@@ -68,94 +158,189 @@ void MsgReader::disable_all_msg_types() {
     _expectedMsgTypes.reset();
 }
 
+void MsgReader::suspend() {
+    _suspended = true;
+}
+
+bool MsgReader::resume() {
+    if (!_suspended) {
+        return true;
+    }
+    _suspended = false;
+
+    std::vector<uint8_t> data;
+    data.swap(_suspendedData);
+
+    return data.empty() || process(io::EC_OK, data.data(), data.size(), true);
+}
+
 bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size) {
+    return process(connectionStatus, (uint8_t*)data, size, false);
+}
+
+bool MsgReader::new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size) {
+    return process(connectionStatus, (uint8_t*)data, size, true);
+}
+
+bool MsgReader::on_header(const MsgHeader& header, volatile const bool& bAlive) {
+	if (!_protocol.approve_msg_header(_streamId, header))
+		// at this moment, the *this* may be deleted
+		return false;
+
+	if (!bAlive)
+		return false;
+
+	if (!_expectedMsgTypes.test(header.type)) {
+		_protocol.on_unexpected_msg(_streamId, header.type);
+		// at this moment, the *this* may be deleted
+		return false;
+	}
+
+	return bAlive;
+}
+
+void MsgReader::begin_message(const uint8_t* header, uint32_t bodySize) {
+	size_t size = MsgHeader::SIZE + bodySize;
+	if (size > _msgBuffer.size()) {
+		// no need to zero-init or preserve anything, unlike vector::resize
+		_largeBuffer = MsgBufferPool::get().alloc(size, _largeCapacity);
+		_buffer = _largeBuffer;
+	}
+
+	if (header != _buffer)
+		memcpy(_buffer, header, MsgHeader::SIZE);
+
+	_bytesLeft = bodySize;
+	_cursor = _buffer + MsgHeader::SIZE;
+	_state = reading_message;
+}
+
+bool MsgReader::on_message(const uint8_t* msg, size_t size, volatile const bool& bAlive) {
+	if (!_protocol.VerifyMsg(msg, static_cast<uint32_t>(size)))
+	{
+		_protocol.on_corrupt_msg(_streamId);
+		return false;
+	}
+
+	MsgHeader header(msg);
+	if (!_protocol.on_new_message(_streamId, header.type, msg + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
+		// at this moment, the *this* may be deleted
+		if (bAlive) {
+			reset();
+		}
+		return false;
+	}
+
+	return bAlive;
+}
+
+bool MsgReader::suspend_data(const uint8_t* p, size_t sz) {
+    if (_suspendedData.size() + sz > max_suspended_size()) {
+        // the peer keeps sending while the connection is being handed over
+        _protocol.on_msg_size_error(_streamId);
+        return false;
+    }
+
+    _suspendedData.insert(_suspendedData.end(), p, p + sz);
+    return true;
+}
+
+size_t MsgReader::max_suspended_size() const {
+    return 2 * (MsgHeader::SIZE + size_t(_protocol.max_message_size()));
+}
+
+bool MsgReader::process(io::ErrorCode connectionStatus, uint8_t* p, size_t sz, bool inPlace) {
     if (connectionStatus != 0) {
         _protocol.on_connection_error(_streamId, connectionStatus);
         return false;
     }
 
-    if (!data || !size) {
+    if (!p || !sz) {
         return true;
     }
 
+    if (_suspended) {
+        return suspend_data(p, sz);
+    }
+
 	std::shared_ptr<bool> pAlive(_pAlive);
 	volatile const bool& bAlive = *pAlive;
 
-    const uint8_t* p = (const uint8_t*)data;
-    size_t sz = size;
-
-	while (sz >= _bytesLeft)
+	while (true)
 	{
+		if (inPlace && (_state == reading_header) && (_cursor == _buffer) && (sz >= MsgHeader::SIZE))
+		{
+			// on the message boundary. Decrypt in place, and if the whole message is here - dispatch it without copying
+			_protocol.Decrypt(p, MsgHeader::SIZE);
+
+			MsgHeader header(p);
+			if (!on_header(header, bAlive))
+				return false;
+
+			size_t msgSize = MsgHeader::SIZE + header.size;
+			if (sz >= msgSize)
+			{
+				_protocol.Decrypt(p + MsgHeader::SIZE, header.size);
+
+				if (!on_message(p, msgSize, bAlive))
+					return false;
+
+				p += msgSize;
+				sz -= msgSize;
+
+				if (_suspended)
+					break;
+				continue;
+			}
+
+			begin_message(p, header.size);
+			p += MsgHeader::SIZE;
+			sz -= MsgHeader::SIZE;
+		}
+
+		if (sz < _bytesLeft)
+			break;
+
 		memcpy(_cursor, p, _bytesLeft);
 		_protocol.Decrypt(_cursor, (uint32_t) _bytesLeft); // decrypt as much as we expect, no more (because cipher may change)
 
 		sz -= _bytesLeft;
 		p += _bytesLeft;
 
-		MsgHeader header(_msgBuffer.data());
-
 		if (_state == reading_header)
 		{
 			// header has just been read
-			if (!_protocol.approve_msg_header(_streamId, header))
-				// at this moment, the *this* may be deleted
+			MsgHeader header(_buffer);
+			if (!on_header(header, bAlive))
 				return false;
 
-			if (!bAlive)
-				return false;
-
-			if (!_expectedMsgTypes.test(header.type)) {
-				_protocol.on_unexpected_msg(_streamId, header.type);
-				// at this moment, the *this* may be deleted
-				return false;
-			}
-
-			if (!bAlive)
-				return false;
-
-			// header deserialized successfully
-			_bytesLeft = header.size;
-			_msgBuffer.resize(MsgHeader::SIZE + _bytesLeft);
-			_cursor = _msgBuffer.data() + MsgHeader::SIZE;
-
-			_state = reading_message;
-
+			begin_message(_buffer, header.size);
 		}
 		else
 		{
 			// whole message has been read
-			if (!_protocol.VerifyMsg(_msgBuffer.data(), static_cast<uint32_t>(_msgBuffer.size())))
-			{
-				_protocol.on_corrupt_msg(_streamId);
-				return false;
-			}
-
-            if (!_protocol.on_new_message(_streamId, header.type, _msgBuffer.data() + MsgHeader::SIZE, header.size - _protocol.get_MacSize())) {
-                // at this moment, the *this* may be deleted
-                if (bAlive) {
-                    reset();
-                }
-                return false;
-            }
-
-			if (!bAlive)
+			MsgHeader header(_buffer);
+			if (!on_message(_buffer, MsgHeader::SIZE + header.size, bAlive))
 				return false;
 
-			if (_msgBuffer.size() > 2 * _defaultSize) {
-				{
-					std::vector<uint8_t> newBuffer;
-					_msgBuffer.swap(newBuffer);
-				}
-				// preventing from excessive memory consumption per individual stream
-				_msgBuffer.resize(_defaultSize);
-			}
 			_bytesLeft = MsgHeader::SIZE;
 			_state = reading_header;
 
-			_cursor = _msgBuffer.data();
+			release_large_buffer();
+			_cursor = _buffer;
+
+			if (_suspended)
+				break;
 		}
 	}
 
+	if (_suspended)
+	{
+		// not decrypted yet
+		_suspendedData.clear();
+		return suspend_data(p, sz);
+	}
+
 	if (sz)
 	{
 		memcpy(_cursor, p, sz);
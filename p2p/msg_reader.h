@@ -33,6 +33,10 @@ public:
     /// Calls the callback whenever a new protocol message is exctracted or on errors
     bool new_data_from_stream(io::ErrorCode connectionStatus, const void* data, size_t size);
 
+    /// Same, but the data may be modified (i.e. it's the stream's read buffer).
+    /// Messages that are entirely in the data are decrypted and deserialized in place, without copying
+    bool new_data_from_stream(io::ErrorCode connectionStatus, void* data, size_t size);
+
     /// Allows receiving messages of given type
     void enable_msg_type(MsgType type);
 
@@ -45,6 +49,12 @@ public:
     /// Disables all messages
     void disable_all_msg_types();
 
+    /// Stops dispatching after the current message, the following data is kept until resumed
+    void suspend();
+
+    /// Dispatches the kept data and continues. Returns false if the reader should stop (it may be deleted already)
+    bool resume();
+
     /// Resets to initial state
     void reset();
 
@@ -52,6 +62,26 @@ private:
     /// 2 states of the reader
     enum State { reading_header, reading_message };
 
+    bool process(io::ErrorCode connectionStatus, uint8_t* p, size_t sz, bool inPlace);
+
+    /// Validates the header, returns false if the reader should stop (it may be deleted already)
+    bool on_header(const MsgHeader& header, volatile const bool& alive);
+
+    /// Prepares the buffer for the message body, the header is copied from the given location
+    void begin_message(const uint8_t* header, uint32_t bodySize);
+
+    /// Verifies and dispatches the whole message (header + body)
+    bool on_message(const uint8_t* msg, size_t size, volatile const bool& alive);
+
+    /// Returns the large message buffer (if any) to the pool
+    void release_large_buffer();
+
+    /// Keeps the data until resumed. If there's too much of it - reports the error, the reader may be deleted then
+    bool suspend_data(const uint8_t* p, size_t sz);
+
+    /// A message of the max size plus the tail of the current one
+    size_t max_suspended_size() const;
+
     /// Callbacks
     ProtocolBase& _protocol;
 
@@ -67,12 +97,23 @@ private:
     /// Current state
     State _state;
 
-    /// Message buffer, grows if needed
+    /// Buffer for headers and messages of the default size
     std::vector<uint8_t> _msgBuffer;
 
+    /// Pooled buffer for the current message, if it doesn't fit the default one
+    uint8_t* _largeBuffer = nullptr;
+    size_t _largeCapacity = 0;
+
+    /// Current message buffer, either of the above
+    uint8_t* _buffer;
+
     /// Cursor inside the buffer
     uint8_t* _cursor;
 
+    /// Data received while suspended, bounded by max_suspended_size()
+    bool _suspended = false;
+    std::vector<uint8_t> _suspendedData;
+
     /// Filter for per-connection protocol logic
     std::bitset<256> _expectedMsgTypes;
 
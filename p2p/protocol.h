@@ -51,6 +51,9 @@ public:
         i.msgHandler = msgHandler;
         i.minSize = minMsgSize;
         i.maxSize = maxMsgSize;
+        if (_maxMessageSize < maxMsgSize) {
+            _maxMessageSize = maxMsgSize;
+        }
     }
 
     /// Called on protocol dispatch table setup
@@ -141,6 +141,11 @@ public:
         return _maxMessageTypes;
     }
 
+    /// The largest message body allowed by the dispatch table
+    uint32_t max_message_size() const {
+        return _maxMessageSize;
+    }
+
     /// Called by MsgReader on receiving message header
     bool approve_msg_header(uint64_t fromStream, const MsgHeader& header) {
         ProtocolError error = no_error;
@@ -180,6 +185,10 @@ public:
 		_errorHandler.on_protocol_error(fromStream, message_corrupted);
 	}
 
+	void on_msg_size_error(uint64_t fromStream) {
+		_errorHandler.on_protocol_error(fromStream, msg_size_error);
+	}
+
     typedef bool(*OnRawMessage)(
         void* msgHandler,
         IErrorHandler& errorHandler,
@@ -223,6 +232,9 @@ protected:
 
     size_t _maxMessageTypes;
 
+    /// Max of the maxSize over the dispatch table
+    uint32_t _maxMessageSize=0;
+
     /// Raw messages dispatch table for this protocol
     DispatchTableItem* _dispatchTable;
 };
@@ -22,6 +22,17 @@
 using namespace grimm;
 using namespace std;
 
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+
 void fragment_writer_test() {
     std::vector<io::SharedBuffer> fragments;
     size_t totalSize=0;
@@ -68,6 +79,7 @@ struct SomeObject {
 struct MsgHandler : IErrorHandler {
     void on_protocol_error(uint64_t fromStream, ProtocolError error) override {
         cout << __FUNCTION__ << "(" << fromStream << "," << error << ")" << endl;
+        lastError = error;
     }
 
     void on_connection_error(uint64_t fromStream, io::ErrorCode errorCode) override {
@@ -83,11 +95,18 @@ struct MsgHandler : IErrorHandler {
     bool on_some_object(uint64_t fromStream, SomeObject&& msg) {
         cout << __FUNCTION__ << "(" << fromStream << "," << msg.i << ")" << endl;
         receivedObj = msg;
+        ++objectsReceived;
+        if (pSuspendOn && (msg == *pSuspendOn)) pReader->suspend();
         return true;
     }
 
     IntList receivedInts;
     SomeObject receivedObj;
+    size_t objectsReceived=0;
+    ProtocolError lastError=no_error;
+
+    const SomeObject* pSuspendOn=nullptr;
+    MsgReader* pReader=nullptr;
 };
 
 void msg_serializer_test_1() {
@@ -183,8 +202,167 @@ void msg_serializer_test_2() {
     assert(msg == handler.receivedObj);
 }
 
+void msg_reader_in_place_test() {
+    MsgType type = 222;
+
+    MsgHandler handler;
+    Protocol protocol(0xAA, 0xBB, 0xCC, 256, handler, 50);
+
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 8, 1<<24);
+
+    // small message, then one that doesn't fit the reader's default buffer
+    SomeObject small;
+    small.i = 1;
+    for (int i=0; i<10; ++i) small.ooo.push_back(i);
+
+    SomeObject large;
+    large.i = 2;
+    for (int i=0; i<10000; ++i) large.ooo.push_back(i);
+
+    std::vector<uint8_t> stream;
+    for (const SomeObject* pMsg : { &small, &large, &small }) {
+        std::vector<io::SharedBuffer> fragments;
+        protocol.serialize(fragments, type, *pMsg);
+        for (const auto& f: fragments) {
+            stream.insert(stream.end(), f.data, f.data + f.size);
+        }
+    }
+
+    for (size_t chunk : { stream.size(), size_t(7), size_t(4096), stream.size() - 3 }) {
+        MsgReader reader(protocol, 123456, 64);
+        handler.objectsReceived = 0;
+
+        // the reader decrypts in place, so the buffer is a scratch copy as the stream's read buffer would be
+        std::vector<uint8_t> buf(stream);
+        for (size_t pos=0; pos < buf.size(); pos += chunk) {
+            size_t size = std::min(chunk, buf.size() - pos);
+            bool ok = reader.new_data_from_stream(io::EC_OK, (void*) (buf.data() + pos), size);
+            CHECK(ok);
+        }
+
+        CHECK(handler.objectsReceived == 3);
+        CHECK(small == handler.receivedObj);
+    }
+
+    // same stream through the copying path
+    MsgReader reader(protocol, 123456, 64);
+    handler.objectsReceived = 0;
+    reader.new_data_from_stream(io::EC_OK, (const void*) stream.data(), stream.size());
+    CHECK(handler.objectsReceived == 3);
+
+    // suspended after the large message, the rest is held until resumed
+    for (size_t chunk : { stream.size(), size_t(7) }) {
+        MsgReader reader(protocol, 123456, 64);
+        handler.objectsReceived = 0;
+        handler.pReader = &reader;
+        handler.pSuspendOn = &large;
+
+        std::vector<uint8_t> buf(stream);
+        for (size_t pos=0; pos < buf.size(); pos += chunk) {
+            size_t size = std::min(chunk, buf.size() - pos);
+            bool ok = reader.new_data_from_stream(io::EC_OK, (void*) (buf.data() + pos), size);
+            CHECK(ok);
+        }
+
+        CHECK(handler.objectsReceived == 2);
+        CHECK(large == handler.receivedObj);
+
+        handler.pSuspendOn = nullptr;
+        bool ok = reader.resume();
+        CHECK(ok);
+        CHECK(handler.objectsReceived == 3);
+        CHECK(small == handler.receivedObj);
+    }
+    handler.pReader = nullptr;
+}
+
+void msg_reader_huge_test() {
+    MsgType type = 222;
+
+    MsgHandler handler;
+    Protocol protocol(0xAA, 0xBB, 0xCC, 256, handler, 50);
+
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 8, 1<<24);
+
+    // a few MB, above the former 1M pool limit. Read twice, the second one reuses the pooled buffer
+    SomeObject huge;
+    huge.i = 4;
+    for (int i=0; i<1000000; ++i) huge.ooo.push_back(i);
+
+    std::vector<uint8_t> stream;
+    for (int i=0; i<2; ++i) {
+        std::vector<io::SharedBuffer> fragments;
+        protocol.serialize(fragments, type, huge);
+        for (const auto& f: fragments) {
+            stream.insert(stream.end(), f.data, f.data + f.size);
+        }
+    }
+    CHECK(stream.size() > 2 * 1024 * 1024);
+
+    MsgReader reader(protocol, 123456, 64);
+    handler.objectsReceived = 0;
+
+    const size_t chunk = 65536;
+    for (size_t pos=0; pos < stream.size(); pos += chunk) {
+        size_t size = std::min(chunk, stream.size() - pos);
+        bool ok = reader.new_data_from_stream(io::EC_OK, (void*) (stream.data() + pos), size);
+        CHECK(ok);
+    }
+
+    CHECK(handler.objectsReceived == 2);
+    CHECK(huge == handler.receivedObj);
+}
+
+void msg_reader_suspended_limit_test() {
+    MsgType type = 222;
+
+    MsgHandler handler;
+    Protocol protocol(0xAA, 0xBB, 0xCC, 256, handler, 50);
+
+    protocol.add_message_handler<MsgHandler, SomeObject, &MsgHandler::on_some_object>(type, &handler, 8, 1024);
+
+    SomeObject small;
+    small.i = 1;
+    for (int i=0; i<10; ++i) small.ooo.push_back(i);
+
+    std::vector<io::SharedBuffer> fragments;
+    protocol.serialize(fragments, type, small);
+    std::vector<uint8_t> msg;
+    for (const auto& f: fragments) {
+        msg.insert(msg.end(), f.data, f.data + f.size);
+    }
+
+    MsgReader reader(protocol, 123456, 64);
+    handler.objectsReceived = 0;
+    handler.pReader = &reader;
+    handler.pSuspendOn = &small;
+
+    // the first message suspends the reader, the rest is held up to 2 max messages, then the peer is dropped
+    bool ok = true;
+    size_t sent = 0;
+    while (ok && (sent < 100000)) {
+        std::vector<uint8_t> buf(msg);
+        ok = reader.new_data_from_stream(io::EC_OK, (void*) buf.data(), buf.size());
+        sent += buf.size();
+    }
+
+    CHECK(!ok);
+    CHECK(sent > msg.size() + 2 * (MsgHeader::SIZE + 1024));
+    CHECK(sent <= 2 * msg.size() + 2 * (MsgHeader::SIZE + 1024));
+    CHECK(handler.objectsReceived == 1);
+    CHECK(handler.lastError == msg_size_error);
+
+    handler.pSuspendOn = nullptr;
+    handler.pReader = nullptr;
+}
+
 int main() {
     fragment_writer_test();
     msg_serializer_test_1();
     msg_serializer_test_2();
+    msg_reader_in_place_test();
+    msg_reader_huge_test();
+    msg_reader_suspended_limit_test();
+
+    return error_count;
 }
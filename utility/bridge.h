@@ -27,10 +27,13 @@ public:
     /// Macros helper
     using BridgeInterface = Interface;
 
+    /// Ring capacity of the channel, the wallet and the node requests come in bursts
+    static constexpr size_t RX_CAPACITY = 1024;
+
     /// Sets up the channel
     Bridge(Interface& _forwardTo, io::Reactor& _reactor) :
         receiver(_forwardTo),
-        rx(_reactor, BIND_THIS_MEMFN(on_rx)),
+        rx(_reactor, BIND_THIS_MEMFN(on_rx), RX_CAPACITY),
         tx(rx.get_tx())
     {}
 
@@ -40,6 +40,7 @@ namespace grimm
         const char* WALLET_STORAGE = "wallet_path";
         const char* MINING_THREADS = "mining_threads";
         const char* VERIFICATION_THREADS = "verification_threads";
+        const char* IO_THREADS = "io_threads";
         const char* NONCEPREFIX_DIGITS = "nonceprefix_digits";
         const char* NODE_PEER = "peer";
         const char* PASS = "pass";
@@ -63,6 +64,8 @@ namespace grimm
         const char* RESET_ID = "reset_id";
         const char* ERASE_ID = "erase_id";
         const char* CHECKDB = "check_db";
+        const char* UTXO_SNAPSHOT = "utxo_snapshot";
+        const char* LAZY_COMMIT = "lazy_commit";
         const char* CRASH = "crash";
         const char* INIT = "init";
         const char* RESTORE = "restore";
@@ -181,6 +184,7 @@ namespace grimm
 
 
             (cli::VERIFICATION_THREADS, po::value<int>()->default_value(-1), "number of threads for cryptographic verifications (0 = single thread, -1 = auto)")
+            (cli::IO_THREADS, po::value<uint32_t>()->default_value(0), "number of threads for peers network I/O (0 = main thread)")
             (cli::NONCEPREFIX_DIGITS, po::value<unsigned>()->default_value(0), "number of hex digits for nonce prefix for stratum client (0..6)")
             (cli::NODE_PEER, po::value<vector<string>>()->multitoken(), "nodes to connect to")
             (cli::STRATUM_PORT, po::value<uint16_t>()->default_value(0), "port to start stratum server on")
@@ -190,6 +194,8 @@ namespace grimm
             (cli::RESET_ID, po::value<bool>()->default_value(false), "Reset self ID (used for network authentication). Must do if the node is cloned")
             (cli::ERASE_ID, po::value<bool>()->default_value(false), "Reset self ID (used for network authentication) and stop before re-creating the new one.")
             (cli::CHECKDB, po::value<bool>()->default_value(false), "DB integrity check and compact (vacuum)")
+            (cli::UTXO_SNAPSHOT, po::value<bool>()->default_value(false), "Save the UTXO set on exit, and load it on start instead of rebuilding")
+            (cli::LAZY_COMMIT, po::value<bool>()->default_value(false), "DB commits don't wait for the disk, the data is synced in background. The last blocks may be lost on power failure")
             (cli::BBS_ENABLE, po::value<bool>()->default_value(true), "Enable SBBS messaging")
             (cli::CRASH, po::value<int>()->default_value(0), "Induce crash (test proper handling)")
             (cli::OWNER_KEY, po::value<string>(), "Owner viewer key")
@@ -35,6 +35,7 @@ namespace grimm
         extern const char* WALLET_STORAGE;
         extern const char* MINING_THREADS;
         extern const char* VERIFICATION_THREADS;
+        extern const char* IO_THREADS;
         extern const char* NONCEPREFIX_DIGITS;
         extern const char* NODE_PEER;
         extern const char* PASS;
@@ -60,6 +61,8 @@ namespace grimm
         extern const char* RESET_ID;
         extern const char* ERASE_ID;
         extern const char* CHECKDB;
+        extern const char* UTXO_SNAPSHOT;
+        extern const char* LAZY_COMMIT;
         extern const char* CRASH;
         extern const char* INIT;
         extern const char* RESTORE;
@@ -19,9 +19,11 @@
 #include "utility/helpers.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #ifndef WIN32
 #include <signal.h>
+#include <unistd.h>
 #endif // WIN32
 
 #ifndef LOG_VERBOSE_ENABLED
@@ -338,6 +340,7 @@ Reactor::Reactor() :
 {
     memset(&_loop,0,sizeof(uv_loop_t));
     memset(&_stopEvent, 0, sizeof(uv_async_t));
+    memset(&_flushEvent, 0, sizeof(uv_prepare_t));
 
     _creatingInternalObjects=true;
 
@@ -363,6 +366,21 @@ Reactor::Reactor() :
         IO_EXCEPTION(errorCode);
     }
       _stopEvent.data = this;
+
+    errorCode = (ErrorCode)uv_prepare_init(&_loop, &_flushEvent);
+    if (errorCode != 0) {
+        uv_close((uv_handle_t*)&_stopEvent, 0);
+        uv_run(&_loop, UV_RUN_NOWAIT);
+        uv_loop_close(&_loop);
+        LOG_ERROR() << "cannot initialize loop flush event, error=" << errorCode;
+        IO_EXCEPTION(errorCode);
+    }
+    _flushEvent.data = this;
+
+    // 0 disables coalescing, every write goes to the socket immediately
+    _writeCoalesceBytes = config().get_int("io.write_coalesce_bytes", 64*1024, 0, 1024*1024*16);
+    _writeCoalesceMsec = config().get_int("io.write_coalesce_msec", 5, 0, 1000);
+
       _pendingWrites  = std::make_unique<PendingWrites>(*this);
       _tcpConnectors  = std::make_unique<TcpConnectors>(*this);
       _tcpShutdowns   = std::make_unique<TcpShutdowns>(*this);
@@ -387,6 +405,9 @@ Reactor::~Reactor() {
     if (_stopEvent.data)
         uv_close((uv_handle_t*)&_stopEvent, 0);
 
+    if (_flushEvent.data)
+        uv_close((uv_handle_t*)&_flushEvent, 0);
+
     // run one cycle to release all closing handles
     uv_run(&_loop, UV_RUN_NOWAIT);
 
@@ -535,6 +556,27 @@ TcpStream* Reactor::stream_connected(TcpStream* stream, uv_handle_t* h) {
     return stream;
 }
 
+std::unique_ptr<TcpStream> Reactor::attach_tcpstream(uv_os_sock_t sock) {
+    TcpStream::Ptr stream(new TcpStream());
+
+    ErrorCode errorCode = init_tcpstream(stream.get());
+    if (errorCode == 0) {
+        errorCode = (ErrorCode)uv_tcp_open((uv_tcp_t*)stream->_handle, sock);
+    }
+
+    if (errorCode != 0) {
+        LOG_DEBUG() << "cannot attach socket, code=" << error_str(errorCode);
+#ifdef WIN32
+        closesocket(sock);
+#else
+        close(sock);
+#endif
+        return TcpStream::Ptr();
+    }
+
+    return stream;
+}
+
 ErrorCode Reactor::accept_tcpstream(Object* acceptor, Object* newConnection) {
     assert(acceptor->_handle);
 
@@ -567,6 +609,36 @@ ErrorCode Reactor::async_write(Reactor::Object* o, BufferChain& unsent, const Re
     return _pendingWrites->async_write(o, unsent, cb);
 }
 
+void Reactor::schedule_flush(TcpStream* stream) {
+    assert(stream);
+    if (_streamsToFlush.empty()) {
+        // prepare callbacks run right before the loop blocks for i/o, i.e. once per tick
+        uv_prepare_start(&_flushEvent, [](uv_prepare_t* handle) {
+            auto reactor = reinterpret_cast<Reactor*>(handle->data);
+            if (reactor) reactor->flush_streams();
+        });
+    }
+    _streamsToFlush.push_back(stream);
+}
+
+void Reactor::cancel_flush(TcpStream* stream) {
+    auto it = std::find(_streamsToFlush.begin(), _streamsToFlush.end(), stream);
+    if (it != _streamsToFlush.end()) {
+        *it = _streamsToFlush.back();
+        _streamsToFlush.pop_back();
+    }
+}
+
+void Reactor::flush_streams() {
+    // streams may be destroyed (and thus unscheduled) by error callbacks, so take them one by one
+    while (!_streamsToFlush.empty()) {
+        TcpStream* stream = _streamsToFlush.back();
+        _streamsToFlush.pop_back();
+        stream->flush_coalesced();
+    }
+    uv_prepare_stop(&_flushEvent);
+}
+
 Result Reactor::tcp_connect(
     Address address,
     uint64_t tag,
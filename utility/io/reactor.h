@@ -21,6 +21,7 @@
 #include <functional>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace grimm { namespace io {
 
@@ -66,6 +67,10 @@ public:
 
     void cancel_tcp_connect(uint64_t tag);
 
+    /// Creates stream from the socket detached from another reactor (see TcpStream::detach_socket).
+    /// Takes ownership of the socket, returns empty ptr on errors
+    std::unique_ptr<TcpStream> attach_tcpstream(uv_os_sock_t sock);
+
 	class Scope
 	{
 		Reactor* m_pPrev;
@@ -154,6 +159,11 @@ private:
     using OnDataWritten = std::function<void(ErrorCode, size_t)>;
     ErrorCode async_write(Reactor::Object* o, BufferChain& unsent, const OnDataWritten& cb);
 
+    /// Coalesced writes: streams with small pending writes are flushed at once before the loop polls for i/o
+    void schedule_flush(TcpStream* stream);
+    void cancel_flush(TcpStream* stream);
+    void flush_streams();
+
     ErrorCode init_object(ErrorCode errorCode, Object* o, uv_handle_t* h);
     void async_close(uv_handle_t*& handle);
 
@@ -165,9 +175,14 @@ private:
 
     uv_loop_t _loop;
     uv_async_t _stopEvent;
+    uv_prepare_t _flushEvent;
     MemPool<uv_handle_t, sizeof(Handles)> _handlePool;
     bool _creatingInternalObjects=false;
 
+    std::vector<TcpStream*> _streamsToFlush;
+    size_t _writeCoalesceBytes=0;
+    unsigned _writeCoalesceMsec=0;
+
     std::unique_ptr<PendingWrites> _pendingWrites;
     std::unique_ptr<TcpConnectors> _tcpConnectors;
     std::unique_ptr<TcpShutdowns> _tcpShutdowns;
@@ -16,6 +16,9 @@
 #include "utility/config.h"
 #include "utility/helpers.h"
 #include <assert.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 #define LOG_DEBUG_ENABLED 0
 #include "utility/logger.h"
@@ -27,6 +30,15 @@ TcpStream::TcpStream() :
 {}
 
 TcpStream::~TcpStream() {
+    // hand the coalesced data (i.e. the last message before disconnect) to the socket, as it'd be without coalescing
+    if (_flushScheduled) {
+        if (is_connected()) {
+            flush_now();
+        } else {
+            _flushScheduled = false;
+            _reactor->cancel_flush(this);
+        }
+    }
     disable_read();
     if (_handle) _handle->data = 0;
 }
@@ -91,6 +103,7 @@ void TcpStream::disable_read() {
 Result TcpStream::write(const SharedBuffer& buf, bool flush) {
     if (!is_connected()) return make_unexpected(EC_ENOTCONN);
     _writeBuffer.append(buf);
+    _state.unsent += buf.size;
     return do_write(flush);
 }
 
@@ -99,6 +112,7 @@ Result TcpStream::write(const SerializedMsg& fragments, bool flush) {
     if (!fragments.empty()) {
         for (const auto& f : fragments) {
             _writeBuffer.append(f);
+            _state.unsent += f.size;
         }
     }
     return do_write(flush);
@@ -114,7 +128,7 @@ Result TcpStream::write(const BufferChain& fragments, bool flush) {
 void TcpStream::shutdown() {
     if (is_connected()) {
         disable_read();
-        do_write(true);
+        flush_now();
         _reactor->shutdown_tcpstream(this);
         assert(!_callback);
         assert(!is_connected());
@@ -127,20 +141,87 @@ void TcpStream::enable_keepalive(unsigned initialDelaySecs) {
     }
 }
 
+Result TcpStream::detach_socket(uv_os_sock_t& sock) {
+    if (!is_connected()) return make_unexpected(EC_ENOTCONN);
+    assert(_writeBuffer.empty() && !_state.unsent);
+
+#ifdef WIN32
+    (void) sock;
+    return make_unexpected(EC_ENOTSUP);
+#else
+    uv_os_fd_t fd;
+    ErrorCode errorCode = (ErrorCode)uv_fileno(_handle, &fd);
+    if (errorCode != 0) {
+        return make_unexpected(errorCode);
+    }
+
+    // the handle closes its own descriptor (and unregisters it from the loop), the duplicate refers to the same socket
+    int newFd = dup(fd);
+    if (newFd < 0) {
+        return make_unexpected((ErrorCode)uv_translate_sys_error(errno));
+    }
+
+    disable_read();
+    async_close();
+
+    sock = newFd;
+    return Ok();
+#endif
+}
+
 Result TcpStream::do_write(bool flush) {
-    size_t nBytes = _writeBuffer.size();
-    if (flush && nBytes > 0) {
+    if (!flush || _writeBuffer.empty()) {
+        return Ok();
+    }
+
+    // Small messages written within the same reactor tick go to the socket in a single request,
+    // unless the batch gets large or old enough
+    if (_writeBuffer.size() < _reactor->_writeCoalesceBytes) {
+        uint64_t now = uv_hrtime() / 1000000;
+        if (!_flushScheduled) {
+            _flushScheduled = true;
+            _coalesceStartTime = now;
+            _reactor->schedule_flush(this);
+            return Ok();
+        }
+        if (now - _coalesceStartTime < _reactor->_writeCoalesceMsec) {
+            return Ok();
+        }
+    }
+
+    return flush_now();
+}
+
+Result TcpStream::flush_now() {
+    if (_flushScheduled) {
+        _flushScheduled = false;
+        _reactor->cancel_flush(this);
+    }
+
+    if (!_writeBuffer.empty()) {
         ErrorCode ec = _reactor->async_write(this, _writeBuffer, _onDataWritten);
         if (ec != EC_OK) {
             LOG_DEBUG() << __FUNCTION__ << " " << error_str(ec);
             return make_unexpected(ec);
         }
-        _state.unsent += nBytes;
     }
-    if (flush) assert(_writeBuffer.empty());
+    assert(_writeBuffer.empty());
     return Ok();
 }
 
+void TcpStream::flush_coalesced() {
+    // already removed from reactor's list
+    _flushScheduled = false;
+
+    if (!is_connected()) return;
+
+    Result res = flush_now();
+    if (!res) {
+        // there's no caller to return the error to
+        on_data_written(res.error(), 0);
+    }
+}
+
 void TcpStream::on_data_written(ErrorCode errorCode, size_t n) {
     if (errorCode != EC_OK) {
         if (_callback) _callback(errorCode, 0, 0);
@@ -148,6 +229,7 @@ void TcpStream::on_data_written(ErrorCode errorCode, size_t n) {
         _state.sent += n;
         assert(_state.unsent >= n);
         _state.unsent -= n;
+        if (_writeCallback) _writeCallback(_state);
     }
     LOG_DEBUG() << __FUNCTION__ << TRACE(n) << TRACE(_state.unsent) << TRACE(_state.sent) << TRACE(_state.received);
 }
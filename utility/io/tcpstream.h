@@ -37,6 +37,9 @@ public:
         size_t unsent=0;
     };
 
+    // called when write requests complete
+    using WriteCallback = std::function<void(const State& state)>;
+
     ~TcpStream();
 
     // Sets callback and enables reading from the stream if callback is not empty
@@ -78,6 +81,15 @@ public:
     /// Enables tcp keep-alive
     void enable_keepalive(unsigned initialDelaySecs);
 
+    /// Sets callback for completed writes, optional
+    void set_write_callback(const WriteCallback& callback) {
+        _writeCallback = callback;
+    }
+
+    /// Detaches the socket, so that it can be attached to another reactor (see Reactor::attach_tcpstream).
+    /// The stream gets closed, must be called before anything is written
+    Result detach_socket(uv_os_sock_t& sock);
+
 protected:
     TcpStream();
 
@@ -95,15 +107,24 @@ private:
     void alloc_read_buffer();
     void free_read_buffer();
 
-    // sends async write request if flush == true
+    // sends async write request if flush == true, small writes are coalesced until the end of reactor's tick
     Result do_write(bool flush);
 
+    // sends async write request with all the pending data
+    Result flush_now();
+
+    // called by reactor for streams with coalesced writes
+    void flush_coalesced();
+
     // callback from write request
     void on_data_written(ErrorCode errorCode, size_t n);
 
     uv_buf_t _readBuffer={0, 0};
     BufferChain _writeBuffer;
+    bool _flushScheduled=false;
+    uint64_t _coalesceStartTime=0;
     Callback _callback;
+    WriteCallback _writeCallback;
     State _state;
     Reactor::OnDataWritten _onDataWritten;
 };
@@ -14,64 +14,173 @@
 
 #pragma once
 #include "io/asyncevent.h"
+#include <atomic>
 #include <mutex>
 #include <deque>
+#include <memory>
 #include <assert.h>
 
 namespace grimm {
 
 /// Inter-thread message queue, backend for RX and TX sides (see below)
-/// Current impl (may be changed if performance bottleneck detected):
-/// 1) unlimited size - should be controlled by channel sides explicitly;
-/// 2) std::deque and std::mutex inside
+/// Current impl:
+/// 1) bounded lock-free multi-producer single-consumer ring (capacity is rounded up to a power of 2).
+///    The default one is small, for the rarely used channels. The busy ones should pass their capacity,
+///    so that the bursts fit the ring under contention;
+/// 2) if the ring is full send() spills into mutex-guarded overflow deque, so the queue is still unlimited
+///    and producers never block. Use try_send() to apply back-pressure instead;
+/// 3) per-producer message order is preserved, also across the ring and overflow
 /// Message type (class T) requirement: default constructible + callable *or* movable (see send() functions)
 template <class T> class MessageQueue {
 public:
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    explicit MessageQueue(size_t capacity=DEFAULT_CAPACITY) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        _mask = n - 1;
+        _slots.reset(new Slot[n]);
+        for (size_t i=0; i<n; ++i) {
+            _slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
     /// Called from sender thread via TX object
     bool send(const T& message) {
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (_rxClosed) return false;
-        _queue.push_back(message);
-        return true;
+        return send_impl(message);
     }
 
     /// Called from sender thread via TX object
     bool send(T&& message) {
-        std::lock_guard<std::mutex> lock(_mutex);
-        if (_rxClosed) return false;
-        _queue.push_back(std::move(message));
-        return true;
+        return send_impl(std::move(message));
+    }
+
+    /// Called from sender thread via TX object. Returns false if the channel is closed or full,
+    /// message is left untouched in this case
+    bool try_send(const T& message) {
+        return try_send_impl(message);
+    }
+
+    /// Called from sender thread via TX object, see above
+    bool try_send(T&& message) {
+        return try_send_impl(std::move(message));
     }
 
     /// May be called by both TX and RX
     size_t current_size() {
-        std::lock_guard<std::mutex> lock(_mutex);
-        return _queue.size();
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        return (tail > head ? tail - head : 0) + _overflowSize.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    /// Called from sender thread after successful send(). Returns true if the receiver is to be woken up,
+    /// i.e. only the 1st message after the receiver started draining the queue triggers async event
+    bool need_wakeup() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (_signalled.load(std::memory_order_relaxed)) return false;
+        return !_signalled.exchange(true, std::memory_order_acq_rel);
+    }
+
+    /// Called from receiver thread before draining the queue
+    void on_wakeup() {
+        _signalled.store(false, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
     }
 
     /// Called from receiver thread via RX object
     bool receive(T& message) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        Slot& slot = _slots[head & _mask];
+        if (slot.seq.load(std::memory_order_acquire) == head + 1) {
+            message = std::move(slot.value);
+            slot.value = T(); // don't hold captured objects until the slot is reused
+            slot.seq.store(head + _mask + 1, std::memory_order_release);
+            _head.store(head + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        // Overflow is consumed only after the ring is empty, otherwise order would be broken.
+        // If a sender claimed the slot but hasn't published it yet - it will trigger another wakeup
+        if (!_overflowSize.load(std::memory_order_acquire) || _tail.load(std::memory_order_acquire) != head) return false;
+
         std::lock_guard<std::mutex> lock(_mutex);
-        if (_queue.empty()) return false;
-        message = std::move(_queue.front());
-        _queue.pop_front();
+        if (_overflow.empty()) return false;
+        message = std::move(_overflow.front());
+        _overflow.pop_front();
+        _overflowSize.fetch_sub(1, std::memory_order_release);
         return true;
     }
 
     /// Called by RX to indicate that the channel is being closed
     void close_rx() {
-        std::lock_guard<std::mutex> lock(_mutex);
-        _rxClosed = true;
+        _rxClosed.store(true, std::memory_order_release);
+    }
+
+    /// Called by TX, the receiver may be gone after the message was enqueued
+    bool is_rx_closed() const {
+        return _rxClosed.load(std::memory_order_acquire);
     }
 
 private:
-    std::mutex _mutex;
-    // TODO consider spinlock
+    struct Slot {
+        std::atomic<size_t> seq;
+        T value;
+    };
+
+    template <class M> bool push_ring(M&& message) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        Slot* slot;
+        for (;;) {
+            slot = &_slots[pos & _mask];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = std::forward<M>(message);
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class M> bool send_impl(M&& message) {
+        if (_rxClosed.load(std::memory_order_acquire)) return false;
+
+        // Once something spilled into overflow - keep appending there until the receiver drains it
+        if (!_overflowSize.load(std::memory_order_acquire) && push_ring(std::forward<M>(message))) return true;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _overflow.push_back(std::forward<M>(message));
+        _overflowSize.fetch_add(1, std::memory_order_release);
+        return true;
+    }
 
-    std::deque<T> _queue;
+    template <class M> bool try_send_impl(M&& message) {
+        if (_rxClosed.load(std::memory_order_acquire)) return false;
+        if (_overflowSize.load(std::memory_order_acquire)) return false;
+        return push_ring(std::forward<M>(message));
+    }
+
+    // producers and consumer positions on separate cache lines
+    alignas(64) std::atomic<size_t> _tail { 0 };
+    alignas(64) std::atomic<size_t> _head { 0 };
+    alignas(64) std::atomic<bool> _signalled { false };
+    std::atomic<bool> _rxClosed { false };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask=0;
 
-    bool _rxClosed=false;
-    // TODO consider atomic flag
+    std::mutex _mutex;
+    std::deque<T> _overflow;
+    std::atomic<size_t> _overflowSize { 0 };
 };
 
 /// Transmitter side of inter-thread channel
@@ -79,15 +188,24 @@ template <class T> class TX {
 public:
 
     bool send(const T& message) {
-        return _queue->send(message) && _asyncEvent();
+        return _queue->send(message) && wakeup();
     }
 
     bool send(T&& message) {
-        return _queue->send(std::move(message)) && _asyncEvent();
+        return _queue->send(std::move(message)) && wakeup();
+    }
+
+    /// Doesn't enqueue the message if the receiver is behind by queue capacity, returns false then
+    bool try_send(const T& message) {
+        return _queue->try_send(message) && wakeup();
+    }
+
+    bool try_send(T&& message) {
+        return _queue->try_send(std::move(message)) && wakeup();
     }
 
     size_t queue_size() {
-        return _queue.current_size();
+        return _queue->current_size();
     }
 
 private:
@@ -98,6 +216,13 @@ private:
         _queue(queue), _asyncEvent(asyncEvent)
     {}
 
+    bool wakeup() {
+        if (!_queue->need_wakeup()) {
+            return !_queue->is_rx_closed(); // already signalled, but the receiver may be destroyed meanwhile
+        }
+        return bool(_asyncEvent());
+    }
+
     /// Queue
     std::shared_ptr<MessageQueue<T>> _queue;
 
@@ -112,8 +237,8 @@ public:
     using Callback = std::function<void(T&& message)>;
 
     /// Ctor called by receiver side
-    explicit RX(io::Reactor& reactor, Callback&& callback) :
-        _queue(std::make_shared<MessageQueue<T>>()),
+    explicit RX(io::Reactor& reactor, Callback&& callback, size_t capacity=MessageQueue<T>::DEFAULT_CAPACITY) :
+        _queue(std::make_shared<MessageQueue<T>>(capacity)),
         _asyncEvent(io::AsyncEvent::create(reactor, [this]() { on_receive(); } )),
         _callback(std::move(callback))
     {
@@ -132,7 +257,7 @@ public:
     }
 
     size_t queue_size() {
-        return _queue.current_size();
+        return _queue->current_size();
     }
 
     void close() {
@@ -141,6 +266,7 @@ public:
 
 private:
     void on_receive() {
+        _queue->on_wakeup();
         while (_queue->receive(_msg)) {
             _callback(std::move(_msg));
         }
@@ -155,4 +281,3 @@ private:
 };
 
 } //namespace
-
@@ -14,12 +14,24 @@
 
 #include "utility/message_queue.h"
 #include <future>
+#include <thread>
+#include <chrono>
 #include <iostream>
 #include <assert.h>
 
 using namespace std;
 using namespace grimm;
 
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
 static const string testStr("some moveble data");
 
 struct Message {
@@ -88,7 +100,120 @@ void simplex_channel_test() {
     assert(remote.received == sent);
 }
 
-int main() {
+void back_pressure_test() {
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    std::vector<int> received;
+    RX<int> rx(
+        *reactor,
+        [&](int&& n) {
+            received.push_back(n);
+            if (n == 0) reactor->stop();
+        },
+        4
+    );
+    TX<int> tx = rx.get_tx();
+
+    std::vector<int> sent;
+    for (int i=1; i<=4; ++i) {
+        bool ok = tx.try_send(i);
+        CHECK(ok);
+        sent.push_back(i);
+    }
+
+    // ring is full, try_send rejects, send spills into overflow
+    bool ok = tx.try_send(5);
+    CHECK(!ok);
+    ok = tx.send(5);
+    CHECK(ok);
+    sent.push_back(5);
+    ok = tx.try_send(6); // until overflow is drained
+    CHECK(!ok);
+    CHECK(tx.queue_size() == 5);
+
+    tx.send(0);
+    sent.push_back(0);
+
+    reactor->run();
+
+    CHECK(received == sent);
+    CHECK(rx.queue_size() == 0);
+}
+
+void closed_rx_test() {
+    io::Reactor::Ptr reactor = io::Reactor::create();
+    std::unique_ptr<RX<int>> rx = std::make_unique<RX<int>>(*reactor, [](int&&) {});
+    TX<int> tx = rx->get_tx();
+
+    bool ok = tx.send(1); // wakes up the receiver
+    CHECK(ok);
+    ok = tx.send(2); // already signalled
+    CHECK(ok);
+
+    rx.reset();
+    ok = tx.send(3);
+    CHECK(!ok);
+}
+
+struct BenchMessage {
+    uint32_t producer=0;
+    uint32_t n=0;
+};
+
+// Multiple producers, the order of each one must be preserved. Prints the throughput in the benchmark mode
+void contention_test(uint32_t total, bool bench) {
+    for (uint32_t producers : { 1, 2, 4, 8 }) {
+        io::Reactor::Ptr reactor = io::Reactor::create();
+        std::vector<uint32_t> last(producers, 0);
+        uint32_t received = 0;
+        bool inOrder = true;
+        const uint32_t perProducer = total / producers;
+
+        RX<BenchMessage> rx(
+            *reactor,
+            [&](BenchMessage&& msg) {
+                if (msg.n != last[msg.producer] + 1) inOrder = false;
+                last[msg.producer] = msg.n;
+                if (++received == perProducer * producers) reactor->stop();
+            }
+        );
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (uint32_t i=0; i<producers; ++i) {
+            threads.emplace_back([&rx, i, perProducer]() {
+                TX<BenchMessage> tx = rx.get_tx();
+                for (uint32_t n=1; n<=perProducer; ++n) {
+                    tx.send(BenchMessage { i, n });
+                }
+            });
+        }
+
+        reactor->run();
+
+        double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (auto& t : threads) t.join();
+
+        CHECK(inOrder);
+        CHECK(received == perProducer * producers);
+        if (bench) {
+            cout << "producers=" << producers << " " << uint64_t(received / sec) << " msg/sec" << endl;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // channel_test --bench: the contention benchmark, too long for the regular test run
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        contention_test(400000, true);
+        return error_count;
+    }
+
     simplex_channel_test();
+    back_pressure_test();
+    closed_rx_test();
+    contention_test(8000, false);
+
+    return error_count;
 }
 
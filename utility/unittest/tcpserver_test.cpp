@@ -78,6 +78,77 @@ void tcpserver_test() {
     }
 }
 
+TcpStream::Ptr serverStream;
+TcpStream::Ptr clientStream;
+std::string expectedData;
+std::string receivedData;
+
+void tcpserver_coalesce_test() {
+    try {
+        reactor = Reactor::create();
+        TcpServer::Ptr server = TcpServer::create(
+            *reactor,
+            Address(serverIp, serverPort + 1),
+            [](TcpStream::Ptr&& newStream, int errorCode) {
+                if (errorCode != 0) {
+                    reactor->stop();
+                    return;
+                }
+                serverStream = std::move(newStream);
+                serverStream->enable_read([](ErrorCode what, void* data, size_t size) -> bool {
+                    if (what != EC_OK) {
+                        reactor->stop();
+                        return false;
+                    }
+                    receivedData.append((const char*)data, size);
+                    if (receivedData.size() >= expectedData.size()) {
+                        reactor->stop();
+                    }
+                    return true;
+                });
+            }
+        );
+
+        reactor->tcp_connect(
+            Address(serverIp, serverPort + 1),
+            1,
+            [](uint64_t, TcpStream::Ptr&& newStream, ErrorCode errorCode) {
+                if (errorCode != 0) {
+                    reactor->stop();
+                    return;
+                }
+                clientStream = std::move(newStream);
+
+                // many small messages within one tick, they're sent when the tick ends
+                for (int i=0; i<1000; ++i) {
+                    std::string msg = std::to_string(i) + ";";
+                    expectedData += msg;
+                    Result res = clientStream->write(msg.data(), msg.size());
+                    if (!res) {
+                        LOG_ERROR() << error_str(res.error());
+                        reactor->stop();
+                        return;
+                    }
+                }
+                assert(clientStream->state().unsent == expectedData.size());
+                assert(clientStream->state().sent == 0);
+            },
+            1000, false, Address(clientIp, 0)
+        );
+
+        reactor->run();
+
+        assert(clientStream && clientStream->state().sent == expectedData.size());
+        assert(clientStream->state().unsent == 0);
+    }
+    catch (const std::exception& e) {
+        LOG_ERROR() << e.what();
+    }
+
+    clientStream.reset();
+    serverStream.reset();
+}
+
 int main() {
     int logLevel = LOG_LEVEL_DEBUG;
 #if LOG_VERBOSE_ENABLED
@@ -85,7 +156,8 @@ int main() {
 #endif
     auto logger = Logger::create(logLevel, logLevel);
     tcpserver_test();
-    return wasAccepted ? 0 : 1;
+    tcpserver_coalesce_test();
+    return (wasAccepted && !expectedData.empty() && receivedData == expectedData) ? 0 : 1;
 }
 
 
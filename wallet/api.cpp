@@ -519,6 +519,15 @@ namespace grimm::wallet
             {
                 txList.filter.height = (Height)params["filter"]["height"];
             }
+
+            if (existsJsonParam(params["filter"], "peer"))
+            {
+                WalletID peer(Zero);
+                if (!params["filter"]["peer"].is_string() || !peer.FromHex(params["filter"]["peer"]))
+                    throw jsonrpc_exception{ INVALID_PARAMS_JSON_RPC , "Invalid 'peer' parameter.", id };
+
+                txList.filter.peer = peer;
+            }
         }
 
         if (existsJsonParam(params, "count"))
@@ -539,6 +548,17 @@ namespace grimm::wallet
             else throw jsonrpc_exception{ INVALID_JSON_RPC , "Invalid 'skip' parameter.", id };
         }
 
+        if (existsJsonParam(params, "after"))
+        {
+            auto txId = from_hex(params["after"]);
+            TxID after;
+            if (txId.size() != after.size())
+                throw jsonrpc_exception{ INVALID_PARAMS_JSON_RPC , "Invalid 'after' parameter.", id };
+
+            std::copy_n(txId.begin(), after.size(), after.begin());
+            txList.after = after;
+        }
+
         _handler.onMessage(id, txList);
     }
 
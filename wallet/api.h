@@ -252,10 +252,12 @@ namespace grimm::wallet
         {
             boost::optional<wallet::TxStatus> status;
             boost::optional<Height> height;
+            boost::optional<WalletID> peer;
         } filter;
 
         int count = 0;
         int skip = 0;
+        boost::optional<TxID> after; // continue after this tx, instead of skipping
 
         struct Response
         {
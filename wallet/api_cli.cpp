@@ -717,8 +717,34 @@ namespace
 
                 TxList::Response res;
 
+                // filtering and paging are done by the db, on the tx summary index
+                TxHistoryQuery query;
+                query.m_TxType = TxType::Simple;
+                query.m_Status = data.filter.status;
+                query.m_PeerID = data.filter.peer;
+                if (data.filter.height)
+                {
+                    query.m_HeightMin = query.m_HeightMax = *data.filter.height;
+                }
+
+                if (data.after)
+                {
+                    query.m_After = _walletDB->getTx(*data.after);
+                    if (!query.m_After)
+                    {
+                        doError(id, INVALID_PARAMS_JSON_RPC, "Unknown 'after' transaction.");
+                        return;
+                    }
+                }
+
+                if (data.count > 0)
+                {
+                    query.m_Skip = data.skip;
+                    query.m_Count = data.count;
+                }
+
                 {
-                    auto txList = _walletDB->getTxHistory();
+                    auto txList = _walletDB->getTxHistoryPage(query);
 
                     Block::SystemState::ID stateID = {};
                     _walletDB->getSystemStateID(stateID);
@@ -736,34 +762,6 @@ namespace
                     }
                 }
 
-                using Result = decltype(res.resultList);
-
-                // filter transactions by status if provided
-                if (data.filter.status)
-                {
-                    Result filteredList;
-
-                    for (const auto& it : res.resultList)
-                        if (it.tx.m_status == *data.filter.status)
-                            filteredList.push_back(it);
-
-                    res.resultList = filteredList;
-                }
-
-                // filter transactions by height if provided
-                if (data.filter.height)
-                {
-                    Result filteredList;
-
-                    for (const auto& it : res.resultList)
-                        if (it.kernelProofHeight == *data.filter.height)
-                            filteredList.push_back(it);
-
-                    res.resultList = filteredList;
-                }
-
-                doPagination(data.skip, data.count, res.resultList);
-
                 doResponse(id, res);
             }
 
@@ -863,6 +863,135 @@ void TestTxParameters()
     WALLET_CHECK(p == pt2);
 }
 
+void TestTxParametersBatch()
+{
+    cout << "\nWallet database batched transaction parameters test\n";
+    auto db = createSqliteWalletDB();
+    TxID txID = { {2, 4, 6} };
+
+    std::vector<std::pair<TxParameterID, ByteBuffer>> params;
+    params.emplace_back(TxParameterID::Amount, toByteBuffer(Amount(5)));
+    params.emplace_back(TxParameterID::Fee, toByteBuffer(Amount(1)));
+    params.emplace_back(TxParameterID::Status, toByteBuffer(TxStatus::Pending));
+    WALLET_CHECK(db->setTxParameters(txID, kDefaultSubTxID, params, false));
+
+    Amount amount = 0;
+    WALLET_CHECK(storage::getTxParameter(*db, txID, TxParameterID::Amount, amount));
+    WALLET_CHECK(amount == 5);
+    WALLET_CHECK(storage::getTxParameter(*db, txID, TxParameterID::Fee, amount));
+    WALLET_CHECK(amount == 1);
+
+    // public parameters are kept, private ones are overwritten
+    params[0].second = toByteBuffer(Amount(7));
+    params[2].second = toByteBuffer(TxStatus::Completed);
+    WALLET_CHECK(db->setTxParameters(txID, kDefaultSubTxID, params, false));
+    WALLET_CHECK(storage::getTxParameter(*db, txID, TxParameterID::Amount, amount));
+    WALLET_CHECK(amount == 5);
+    TxStatus status = TxStatus::Pending;
+    WALLET_CHECK(storage::getTxParameter(*db, txID, TxParameterID::Status, status));
+    WALLET_CHECK(status == TxStatus::Completed);
+    WALLET_CHECK(!db->setTxParameters(txID, kDefaultSubTxID, params, false));
+
+    // the same query nested in itself must not share the cached statement
+    for (Amount i = 1; i <= 3; ++i)
+    {
+        Coin c = CreateAvailCoin(i);
+        db->store(c);
+    }
+    size_t nOuter = 0, nInner = 0;
+    db->visit([&](const Coin&)
+    {
+        ++nOuter;
+        db->visit([&](const Coin&)
+        {
+            ++nInner;
+            return true;
+        });
+        return true;
+    });
+    WALLET_CHECK(nOuter == 3);
+    WALLET_CHECK(nInner == 9);
+}
+
+void TestTxHistoryPaging()
+{
+    cout << "\nWallet database transaction history paging test\n";
+    auto db = createSqliteWalletDB();
+
+    const uint32_t nCount = 50;
+    WalletID peer1(Zero), peer2(Zero);
+    peer1.m_Pk = 11U;
+    peer2.m_Pk = 22U;
+
+    for (uint32_t i = 0; i < nCount; ++i)
+    {
+        TxDescription tx;
+        ZeroObject(tx.m_txId);
+        tx.m_txId[0] = static_cast<uint8_t>(i);
+        tx.m_amount = i + 1;
+        tx.m_createTime = 1000 + i / 2; // pairs share the create time
+        tx.m_peerId = (i % 2) ? peer2 : peer1;
+        tx.m_status = (i % 5) ? TxStatus::Completed : TxStatus::Failed;
+        db->saveTx(tx);
+
+        if (TxStatus::Completed == tx.m_status)
+            storage::setTxParameter(*db, tx.m_txId, TxParameterID::KernelProofHeight, Height(100 + i), false);
+    }
+
+    auto all = db->getTxHistory();
+    WALLET_CHECK(all.size() == nCount);
+    for (size_t i = 1; i < all.size(); ++i)
+        WALLET_CHECK(all[i - 1].m_createTime >= all[i].m_createTime);
+
+    // keyset pages must cover everything exactly once, in the same order
+    TxHistoryQuery query;
+    query.m_Count = 7;
+    std::vector<TxDescription> paged;
+    while (true)
+    {
+        auto page = db->getTxHistoryPage(query);
+        if (page.empty())
+            break;
+        WALLET_CHECK(page.size() <= 7);
+        paged.insert(paged.end(), page.begin(), page.end());
+        query.m_After = page.back();
+    }
+    WALLET_CHECK(paged.size() == nCount);
+    for (size_t i = 0; i < std::min(paged.size(), all.size()); ++i)
+        WALLET_CHECK(paged[i].m_txId == all[i].m_txId);
+
+    // skip/count
+    auto page = db->getTxHistory(TxType::Simple, 10, 5);
+    WALLET_CHECK(page.size() == 5);
+    WALLET_CHECK(page[0].m_txId == all[10].m_txId);
+
+    // filters
+    query = TxHistoryQuery();
+    query.m_Status = TxStatus::Failed;
+    WALLET_CHECK(db->getTxHistoryPage(query).size() == nCount / 5);
+
+    query = TxHistoryQuery();
+    query.m_PeerID = peer2;
+    page = db->getTxHistoryPage(query);
+    WALLET_CHECK(page.size() == nCount / 2);
+    for (const auto& tx : page)
+        WALLET_CHECK(tx.m_peerId == peer2);
+
+    query = TxHistoryQuery();
+    query.m_HeightMin = 110;
+    query.m_HeightMax = 119;
+    page = db->getTxHistoryPage(query);
+    WALLET_CHECK(page.size() == 8); // 10..19 except the failed 10 and 15
+
+    // status update is reflected
+    storage::setTxParameter(*db, all[0].m_txId, TxParameterID::Status, TxStatus::Cancelled, false);
+    query = TxHistoryQuery();
+    query.m_Status = TxStatus::Cancelled;
+    page = db->getTxHistoryPage(query);
+    WALLET_CHECK(page.size() == 1);
+    WALLET_CHECK(page[0].m_txId == all[0].m_txId);
+}
+
 void TestSelect3()
 {
     cout << "\nWallet database coin selection 3 test\n";
@@ -1003,6 +1132,65 @@ void TestSelect6()
     }
 }
 
+void TestSelect7()
+{
+    cout << "\nWallet database coin selection 7 test\n";
+    auto db = createSqliteWalletDB();
+    vector<Coin> coins;
+    for (Amount i = 1; i <= 10; ++i)
+    {
+        coins.push_back(CreateAvailCoin(i * 10));
+    }
+    db->store(coins);
+    {
+        Coin coin = CreateAvailCoin(1000, 200); // not mature yet
+        db->store(coin);
+    }
+
+    auto sel = db->selectCoins(100);
+    WALLET_CHECK(sel.size() == 1);
+    WALLET_CHECK(sel[0].m_ID.m_Value == 100);
+
+    // spent coin must leave the index
+    Coin spent = coins[9];
+    spent.m_spentHeight = 130;
+    db->save(spent);
+    sel = db->selectCoins(100);
+    Amount sum = 0;
+    for (const auto& c : sel)
+    {
+        WALLET_CHECK(c.m_ID.m_Value < 100);
+        sum += c.m_ID.m_Value;
+    }
+    WALLET_CHECK(sum >= 100);
+
+    // bounded mode considers the largest coins below the amount first
+    auto walletDB = std::dynamic_pointer_cast<WalletDB>(db);
+    walletDB->setCoinSelectionLimit(2);
+    sel = db->selectCoins(150);
+    WALLET_CHECK(sel.size() == 2);
+    WALLET_CHECK(sel[0].m_ID.m_Value + sel[1].m_ID.m_Value == 170);
+
+    // those aren't enough, all the coins are considered then
+    sel = db->selectCoins(200);
+    sum = 0;
+    for (const auto& c : sel)
+        sum += c.m_ID.m_Value;
+    WALLET_CHECK(sum >= 200);
+    WALLET_CHECK(db->selectCoins(500).empty()); // 450 available
+
+    walletDB->setCoinSelectionLimit(0);
+    WALLET_CHECK(!db->selectCoins(200).empty());
+
+    // the coin matures
+    grimm::Block::SystemState::ID id = { };
+    id.m_Height = 200;
+    db->setSystemStateID(id);
+    sel = db->selectCoins(1000);
+    WALLET_CHECK(sel.size() == 1);
+    WALLET_CHECK(sel[0].m_ID.m_Value == 1000);
+}
+
 void TestWalletMessages()
 {
     auto db = createSqliteWalletDB();
@@ -1112,8 +1300,11 @@ int main()
     TestSelect4();
     TestSelect5();
     TestSelect6();
+    TestSelect7();
     TestAddresses();
     TestTxParameters();
+    TestTxParametersBatch();
+    TestTxHistoryPaging();
     TestWalletMessages();
 
 
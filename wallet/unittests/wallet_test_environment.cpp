@@ -107,6 +107,7 @@ public:
     void unsubscribe(IWalletDbObserver* observer) override {}
 
     std::vector<TxDescription> getTxHistory(wallet::TxType, uint64_t, int) override { return {}; };
+    std::vector<TxDescription> getTxHistoryPage(const TxHistoryQuery&) override { return {}; };
     boost::optional<TxDescription> getTx(const TxID&) override { return boost::optional<TxDescription>{}; };
     void saveTx(const TxDescription& p) override
     {
@@ -166,6 +167,16 @@ public:
         m_params[paramID] = blob;
         return true;
     }
+    bool setTxParameters(const TxID& txID, wallet::SubTxID subTxID, const std::vector<std::pair<wallet::TxParameterID, ByteBuffer>>& params,
+        bool shouldNotifyAboutChanges) override
+    {
+        bool changed = false;
+        for (const auto& p : params)
+        {
+            changed |= setTxParameter(txID, subTxID, p.first, p.second, shouldNotifyAboutChanges);
+        }
+        return changed;
+    }
     bool getTxParameter(const TxID& txID, wallet::SubTxID subTxID, wallet::TxParameterID paramID, ByteBuffer& blob) const override
     {
         auto it = m_params.find(paramID);
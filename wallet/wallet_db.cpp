@@ -64,6 +64,7 @@
 #define VARIABLES_NAME "variables"
 #define ADDRESSES_NAME "addresses"
 #define TX_PARAMS_NAME "txparams"
+#define TX_SUMMARY_NAME "txsummary"
 #define PRIVATE_VARIABLES_NAME "PrivateVariables"
 #define WALLET_MESSAGE_NAME "WalletMessages"
 #define INCOMING_WALLET_MESSAGE_NAME "IncomingWalletMessages"
@@ -92,6 +93,16 @@
 
 #define TX_PARAMS_FIELDS ENUM_TX_PARAMS_FIELDS(LIST, COMMA, )
 
+#define ENUM_TX_SUMMARY_FIELDS(each, sep, obj) \
+    each(txID,           txID,           BLOB NOT NULL PRIMARY KEY, obj) sep \
+    each(txType,         txType,         INTEGER, obj) sep \
+    each(status,         status,         INTEGER, obj) sep \
+    each(createTime,     createTime,     INTEGER NOT NULL, obj) sep \
+    each(proofHeight,    proofHeight,    INTEGER NOT NULL, obj) sep \
+    each(peerID,         peerID,         BLOB, obj)
+
+#define TX_SUMMARY_FIELDS ENUM_TX_SUMMARY_FIELDS(LIST, COMMA, )
+
 #define ENUM_WALLET_MESSAGE_FIELDS(each, sep, obj) \
     each(ID,  ID,  INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, obj) sep \
     each(PeerID, PeerID,   BLOB, obj) sep \
@@ -373,24 +384,27 @@ namespace grimm::wallet
                 : _walletDB(nullptr)
                 , _db(privateDB ? db->m_PrivateDB : db->_db)
                 , _stm(nullptr)
+                , _cached(nullptr)
             {
-                int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, nullptr);
-                throwIfError(ret, _db);
+                acquire(db, sql, privateDB);
             }
 
             Statement(WalletDB* db, const char* sql, bool privateDB = false)
                 : _walletDB(db)
                 , _db(privateDB ? db->m_PrivateDB : db->_db)
                 , _stm(nullptr)
+                , _cached(nullptr)
             {
                 if (_walletDB)
                 {
                   _walletDB->onPrepareToModify();
                 }
-                int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, nullptr);
-                throwIfError(ret, _db);
+                acquire(db, sql, privateDB);
             }
 
+            Statement(const Statement&) = delete;
+            Statement& operator = (const Statement&) = delete;
+
             void Reset()
             {
                 sqlite3_clear_bindings(_stm);
@@ -623,12 +637,44 @@ namespace grimm::wallet
 
             ~Statement()
             {
-                sqlite3_finalize(_stm);
+                if (_cached)
+                {
+                    // give it back to the cache, ready for the next user
+                    Reset();
+                    _cached->m_InUse = false;
+                }
+                else
+                {
+                    sqlite3_finalize(_stm);
+                }
             }
         private:
+            void acquire(const WalletDB* db, const char* sql, bool privateDB)
+            {
+                auto& cached = db->m_Statements[privateDB ? 1 : 0][sql];
+                if (cached.m_pStm && !cached.m_InUse)
+                {
+                    _stm = cached.m_pStm;
+                }
+                else
+                {
+                    int ret = sqlite3_prepare_v2(_db, sql, -1, &_stm, nullptr);
+                    throwIfError(ret, _db);
+
+                    if (cached.m_pStm)
+                        return; // same query is active up the stack, this one is used once
+
+                    cached.m_pStm = _stm;
+                }
+
+                cached.m_InUse = true;
+                _cached = &cached;
+            }
+
             WalletDB* _walletDB;
             sqlite3 * _db;
             sqlite3_stmt* _stm;
+            WalletDB::CachedStatement* _cached;
         };
 
         struct Transaction
@@ -682,7 +728,8 @@ namespace grimm::wallet
         const char* SystemStateIDName = "SystemStateID";
         const char* LastUpdateTimeName = "LastUpdateTime";
         const int BusyTimeoutMs = 5000;
-        const int DbVersion = 15;
+        const int DbVersion = 16;
+        const int DbVersion15 = 15;
         const int DbVersion14 = 14;
         const int DbVersion13 = 13;
         const int DbVersion12 = 12;
@@ -849,6 +896,31 @@ namespace grimm::wallet
             throwIfError(ret, db);
         }
 
+        void CreateTxSummaryTable(sqlite3* db)
+        {
+            // the index covers all the columns history pages are ordered and filtered by
+            const char* req = "CREATE TABLE " TX_SUMMARY_NAME " (" ENUM_TX_SUMMARY_FIELDS(LIST_WITH_TYPES, COMMA, ) ") WITHOUT ROWID;"
+                "CREATE INDEX TxSummaryIndex ON " TX_SUMMARY_NAME "(createTime DESC, txID, txType, status, proofHeight, peerID);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
+        bool IsTxSummaryParam(TxParameterID paramID)
+        {
+            switch (paramID)
+            {
+            case TxParameterID::TransactionType:
+            case TxParameterID::Status:
+            case TxParameterID::CreateTime:
+            case TxParameterID::KernelProofHeight:
+            case TxParameterID::PeerID:
+                return true;
+
+            default:
+                return false;
+            }
+        }
+
         void CreateStatesTable(sqlite3* db)
         {
             const char* req = "CREATE TABLE [" TblStates "] ("
@@ -887,6 +959,7 @@ namespace grimm::wallet
             CreateVariablesTable(walletDB->_db);
             CreateAddressesTable(walletDB->_db);
             CreateTxParamsTable(walletDB->_db);
+            CreateTxSummaryTable(walletDB->_db);
             CreateStatesTable(walletDB->_db);
 
             {
@@ -1057,6 +1130,27 @@ namespace grimm::wallet
                             }
 
                         }
+                        // no break;
+
+                    case DbVersion15:
+                        {
+                            LOG_INFO() << "Converting DB from format 15";
+
+                            // added tx summary table, fill it from the existing tx parameters
+                            CreateTxSummaryTable(walletDB->_db);
+
+                            std::vector<TxID> txIDs;
+                            {
+                                // deleted txs keep only their type, skip them
+                                sqlite::Statement stm(walletDB.get(), "SELECT DISTINCT txID FROM " TX_PARAMS_NAME " WHERE paramID=?1;");
+                                stm.bind(1, TxParameterID::Status);
+                                while (stm.step())
+                                    stm.get(0, txIDs.emplace_back());
+                            }
+
+                            for (const auto& txID : txIDs)
+                                walletDB->updateTxSummary(txID);
+                        }
 
                         storage::setVar(*walletDB, Version, DbVersion);
                         // no break;
@@ -1160,6 +1254,7 @@ namespace grimm::wallet
                 }
                 m_DbTransaction.reset();
             }
+            finalizeStatements();
             GRIMM_VERIFY(SQLITE_OK == sqlite3_close(_db));
             if (m_PrivateDB && _db != m_PrivateDB)
             {
@@ -1254,29 +1349,63 @@ namespace grimm::wallet
         Block::SystemState::ID stateID = {};
         getSystemStateID(stateID);
 
+        const SpendableCoins& spendable = get_SpendableCoins();
+
+        auto fnAvailable = [this, &stateID](const Coin& c, Coin& coin)
         {
-            sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND maturity<=?1 AND spentHeight<0 ORDER BY amount ASC");
-            stm.bind(1, stateID.m_Height);
+            if (c.m_maturity > stateID.m_Height)
+                return false;
 
-            while (stm.step())
+            coin = c;
+            storage::DeduceStatus(*this, coin, stateID.m_Height);
+            return Coin::Status::Available == coin.m_status;
+        };
+
+        Coin::ID cidGoal(Zero);
+        cidGoal.m_Value = amount;
+        auto itGoal = spendable.lower_bound(cidGoal);
+
+        auto fnSelect = [&](size_t nMax, bool& bTruncated)
+        {
+            coins.clear();
+            bTruncated = false;
+
+            // coins below the amount, starting from the largest one
+            for (auto it = itGoal; it != spendable.begin(); )
             {
-                auto& coin = coins.emplace_back();
-                int colIdx = 0;
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+                if (coins.size() == nMax)
+                {
+                    bTruncated = true;
+                    break;
+                }
 
-                storage::DeduceStatus(*this, coin, stateID.m_Height);
-                if (Coin::Status::Available != coin.m_status)
-                    coins.pop_back();
-                else
+                --it;
+                Coin coin;
+                if (fnAvailable(it->second, coin))
+                    coins.push_back(std::move(coin));
+            }
+            std::reverse(coins.begin(), coins.end()); // the selector expects ascending order
+
+            // and the smallest one that covers it alone
+            for (auto it = itGoal; it != spendable.end(); ++it)
+            {
+                Coin coin;
+                if (fnAvailable(it->second, coin))
                 {
-                    if (coin.m_ID.m_Value >= amount)
-                        break;
+                    coins.push_back(std::move(coin));
+                    break;
                 }
             }
-        }
 
-        CoinSelector3 csel(coins);
-        CoinSelector3::Result res = csel.Select(amount);
+            CoinSelector3 csel(coins);
+            return csel.Select(amount);
+        };
+
+        bool bTruncated = false;
+        CoinSelector3::Result res = fnSelect(m_MaxSelectCandidates ? m_MaxSelectCandidates : spendable.size(), bTruncated);
+
+        if ((res.first < amount) && bTruncated)
+            res = fnSelect(spendable.size(), bTruncated); // the largest coins below the amount aren't enough, consider all of them
 
         if (res.first >= amount)
         {
@@ -1290,6 +1419,55 @@ namespace grimm::wallet
         return coinsSel;
     }
 
+    void WalletDB::setCoinSelectionLimit(size_t nMaxCandidates)
+    {
+        m_MaxSelectCandidates = nMaxCandidates;
+    }
+
+    const WalletDB::SpendableCoins& WalletDB::get_SpendableCoins()
+    {
+        if (!m_SpendableCoinsValid)
+        {
+            m_SpendableCoins.clear();
+
+            sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND spentHeight<0;");
+            while (stm.step())
+            {
+                Coin coin;
+                int colIdx = 0;
+                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+                m_SpendableCoins.emplace(coin.m_ID, std::move(coin));
+            }
+
+            m_SpendableCoinsValid = true;
+        }
+
+        return m_SpendableCoins;
+    }
+
+    void WalletDB::updateSpendableCoin(const Coin& coin)
+    {
+        if (!m_SpendableCoinsValid)
+            return;
+
+        if ((MaxHeight != coin.m_maturity) && (MaxHeight == coin.m_spentHeight))
+            m_SpendableCoins[coin.m_ID] = coin;
+        else
+            m_SpendableCoins.erase(coin.m_ID);
+    }
+
+    void WalletDB::removeSpendableCoin(const Coin::ID& cid)
+    {
+        if (m_SpendableCoinsValid)
+            m_SpendableCoins.erase(cid);
+    }
+
+    void WalletDB::resetSpendableCoins()
+    {
+        m_SpendableCoinsValid = false;
+        m_SpendableCoins.clear();
+    }
+
     std::vector<Coin> WalletDB::getCoinsCreatedByTx(const TxID& txId)
     {
         // select all coins for TxID
@@ -1370,6 +1548,8 @@ namespace grimm::wallet
         int colIdx = 0;
         ENUM_ALL_STORAGE_FIELDS(STM_BIND_LIST, NOSEP, coin);
         stm.step();
+
+        updateSpendableCoin(coin);
     }
 
     void WalletDB::insertNew(Coin& coin)
@@ -1393,7 +1573,11 @@ namespace grimm::wallet
         ENUM_STORAGE_ID(STM_BIND_LIST, NOSEP, coin);
         stm.step();
 
-        return sqlite3_changes(_db) > 0;
+        if (sqlite3_changes(_db) <= 0)
+            return false;
+
+        updateSpendableCoin(coin);
+        return true;
     }
 
     void WalletDB::saveRaw(const Coin& coin)
@@ -1512,6 +1696,8 @@ namespace grimm::wallet
         STORAGE_BIND_ID(wrp)
 
         stm.step();
+
+        removeSpendableCoin(cid);
     }
 
     void WalletDB::remove(const Coin::ID& cid)
@@ -1525,6 +1711,7 @@ namespace grimm::wallet
         {
             sqlite::Statement stm(this, "DELETE FROM " STORAGE_NAME ";");
             stm.step();
+            resetSpendableCoins();
             notifyCoinsChanged();
         }
     }
@@ -1691,70 +1878,134 @@ namespace grimm::wallet
             stm.step();
         }
 
+        resetSpendableCoins();
         notifyCoinsChanged();
     }
 
     vector<TxDescription> WalletDB::getTxHistory(wallet::TxType txType, uint64_t start, int count)
     {
-        // TODO this is temporary solution
-        int txCount = 0;
-        {
-            std::string req = "SELECT COUNT(DISTINCT txID) FROM " TX_PARAMS_NAME " WHERE paramID = ?1";
-            req += (txType != wallet::TxType::ALL) ? " AND value = ?2 ;" : " ;";
+        TxHistoryQuery query;
+        query.m_TxType = txType;
+        query.m_Skip = start;
+        query.m_Count = count;
+        return getTxHistoryPage(query);
+    }
 
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, wallet::TxParameterID::TransactionType);
+    vector<TxDescription> WalletDB::getTxHistoryPage(const TxHistoryQuery& query)
+    {
+        vector<TxDescription> res;
+        if (query.m_Count <= 0)
+            return res;
 
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                typeBlob = toByteBuffer(txType);
-                stm.bind(2, typeBlob);
-            }
+        std::string req = "SELECT txID FROM " TX_SUMMARY_NAME " WHERE ";
+        if (query.m_After)
+            req += "createTime<=?1 AND (createTime<?1 OR txID>?2) AND "; // seek, not scan
 
-            stm.step();
-            stm.get(0, txCount);
+        req += "(?3 IS NULL OR txType=?3) AND (?4 IS NULL OR status=?4) AND (?5 IS NULL OR peerID=?5) AND "
+            "proofHeight>=?6 AND (?7 IS NULL OR proofHeight<=?7) "
+            "ORDER BY createTime DESC, txID LIMIT -1 OFFSET ?8;";
+
+        sqlite::Statement stm(this, req.c_str());
+
+        if (query.m_After)
+        {
+            stm.bind(1, query.m_After->m_createTime);
+            stm.bind(2, query.m_After->m_txId);
         }
 
-        vector<TxDescription> res;
-        if (txCount > 0)
+        if (query.m_TxType != wallet::TxType::ALL)
+            stm.bind(3, static_cast<int>(query.m_TxType));
+        if (query.m_Status)
+            stm.bind(4, *query.m_Status);
+
+        ByteBuffer peerBlob;
+        if (query.m_PeerID)
         {
-            res.reserve(static_cast<size_t>(min(txCount, count)));
-            std::string req = "SELECT DISTINCT txID FROM " TX_PARAMS_NAME;
+            peerBlob = toByteBuffer(*query.m_PeerID);
+            stm.bind(5, peerBlob);
+        }
+
+        stm.bind(6, query.m_HeightMin);
+        if (query.m_HeightMax != MaxHeight)
+            stm.bind(7, query.m_HeightMax);
+        stm.bind(8, query.m_Skip);
 
-            if (txType != wallet::TxType::ALL)
+        while ((res.size() < static_cast<size_t>(query.m_Count)) && stm.step())
+        {
+            TxID txID;
+            stm.get(0, txID);
+            auto t = getTx(txID);
+            if (t.is_initialized())
             {
-                req += " WHERE paramID = ?3 AND value = ?4";
+                res.emplace_back(std::move(*t));
             }
+        }
 
-            req += " LIMIT ?1 OFFSET ?2 ;";
+        return res;
+    }
 
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, count);
-            stm.bind(2, start);
+    void WalletDB::updateTxSummary(const TxID& txID)
+    {
+        const char* req = "SELECT paramID, value FROM " TX_PARAMS_NAME " WHERE txID=?1 AND subTxID=?2 AND paramID IN (?3, ?4, ?5, ?6, ?7);";
+        sqlite::Statement stm(this, req);
+        stm.bind(1, txID);
+        stm.bind(2, kDefaultSubTxID);
+        stm.bind(3, TxParameterID::TransactionType);
+        stm.bind(4, TxParameterID::Status);
+        stm.bind(5, TxParameterID::CreateTime);
+        stm.bind(6, TxParameterID::KernelProofHeight);
+        stm.bind(7, TxParameterID::PeerID);
+
+        wallet::TxType txType = wallet::TxType::Simple;
+        TxStatus status = TxStatus::Pending;
+        Timestamp createTime = 0;
+        Height proofHeight = 0;
+        ByteBuffer peerID;
+        bool hasType = false, hasStatus = false, hasPeer = false;
 
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                stm.bind(3, wallet::TxParameterID::TransactionType);
-                typeBlob = toByteBuffer(txType);
-                stm.bind(4, typeBlob);
-            }
+        while (stm.step())
+        {
+            int paramID = 0;
+            ByteBuffer value;
+            stm.get(0, paramID);
+            stm.get(1, value);
 
-            while (stm.step())
+            switch (static_cast<TxParameterID>(paramID))
             {
-                TxID txID;
-                stm.get(0, txID);
-                auto t = getTx(txID);
-                if (t.is_initialized())
-                {
-                    res.emplace_back(*t);
-                }
+            case TxParameterID::TransactionType:
+                deserialize(txType, value);
+                hasType = true;
+                break;
+            case TxParameterID::Status:
+                deserialize(status, value);
+                hasStatus = true;
+                break;
+            case TxParameterID::CreateTime:
+                deserialize(createTime, value);
+                break;
+            case TxParameterID::KernelProofHeight:
+                deserialize(proofHeight, value);
+                break;
+            case TxParameterID::PeerID:
+                peerID = std::move(value);
+                hasPeer = true;
+                break;
+            default:
+                break; // suppress warning
             }
-            sort(res.begin(), res.end(), [](const auto& left, const auto& right) {return left.m_createTime > right.m_createTime; });
         }
 
-        return res;
+        sqlite::Statement stm2(this, "INSERT OR REPLACE INTO " TX_SUMMARY_NAME " (" TX_SUMMARY_FIELDS ") VALUES(" ENUM_TX_SUMMARY_FIELDS(BIND_LIST, COMMA, ) ");");
+        stm2.bind(1, txID);
+        if (hasType)
+            stm2.bind(2, static_cast<int>(txType));
+        if (hasStatus)
+            stm2.bind(3, status);
+        stm2.bind(4, createTime);
+        stm2.bind(5, proofHeight);
+        if (hasPeer)
+            stm2.bind(6, peerID);
+        stm2.step();
     }
 
     boost::optional<TxDescription> WalletDB::getTx(const TxID& txId)
@@ -1846,22 +2097,25 @@ namespace grimm::wallet
     {
         ChangeAction action = ChangeAction::Added;
 
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::TransactionType, p.m_txType, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::Amount, p.m_amount, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::Fee, p.m_fee, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::Change, p.m_change, false);
+        std::vector<std::pair<TxParameterID, ByteBuffer>> params;
+        params.reserve(13);
+        params.emplace_back(TxParameterID::TransactionType, toByteBuffer(p.m_txType));
+        params.emplace_back(TxParameterID::Amount, toByteBuffer(p.m_amount));
+        params.emplace_back(TxParameterID::Fee, toByteBuffer(p.m_fee));
+        params.emplace_back(TxParameterID::Change, toByteBuffer(p.m_change));
         if (p.m_minHeight)
         {
-            storage::setTxParameter(*this, p.m_txId, TxParameterID::MinHeight, p.m_minHeight, false);
+            params.emplace_back(TxParameterID::MinHeight, toByteBuffer(p.m_minHeight));
         }
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::PeerID, p.m_peerId, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::MyID, p.m_myId, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::Message, p.m_message, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::CreateTime, p.m_createTime, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::ModifyTime, p.m_modifyTime, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::IsSender, p.m_sender, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::Status, p.m_status, false);
-        storage::setTxParameter(*this, p.m_txId, TxParameterID::IsSelfTx, p.m_selfTx, false);
+        params.emplace_back(TxParameterID::PeerID, toByteBuffer(p.m_peerId));
+        params.emplace_back(TxParameterID::MyID, toByteBuffer(p.m_myId));
+        params.emplace_back(TxParameterID::Message, p.m_message);
+        params.emplace_back(TxParameterID::CreateTime, toByteBuffer(p.m_createTime));
+        params.emplace_back(TxParameterID::ModifyTime, toByteBuffer(p.m_modifyTime));
+        params.emplace_back(TxParameterID::IsSender, toByteBuffer(p.m_sender));
+        params.emplace_back(TxParameterID::Status, toByteBuffer(p.m_status));
+        params.emplace_back(TxParameterID::IsSelfTx, toByteBuffer(p.m_selfTx));
+        setTxParameters(p.m_txId, kDefaultSubTxID, params, false);
 
         // notify only when full TX saved
         notifyTransactionChanged(action, {p});
@@ -1880,6 +2134,11 @@ namespace grimm::wallet
 
             stm.step();
             deleteParametersFromCache(txId);
+
+            sqlite::Statement stm2(this, "DELETE FROM " TX_SUMMARY_NAME " WHERE txID=?1;");
+            stm2.bind(1, txId);
+            stm2.step();
+
             notifyTransactionChanged(ChangeAction::Removed, { *tx });
         }
     }
@@ -1899,6 +2158,7 @@ namespace grimm::wallet
             stm.bind(2, MaxHeight);
             stm.step();
         }
+        resetSpendableCoins();
         notifyCoinsChanged();
     }
 
@@ -2026,6 +2286,56 @@ namespace grimm::wallet
     }
 
     bool WalletDB::setTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob, bool shouldNotifyAboutChanges)
+    {
+        bool hasTx = shouldNotifyAboutChanges && getTx(txID).is_initialized();
+        if (!setTxParameterRaw(txID, subTxID, paramID, blob))
+            return false;
+
+        if ((kDefaultSubTxID == subTxID) && IsTxSummaryParam(paramID))
+            updateTxSummary(txID);
+
+        if (shouldNotifyAboutChanges)
+        {
+            auto tx = getTx(txID);
+            if (tx.is_initialized())
+            {
+                notifyTransactionChanged(hasTx ? ChangeAction::Updated : ChangeAction::Added, { *tx });
+            }
+        }
+        return true;
+    }
+
+    bool WalletDB::setTxParameters(const TxID& txID, SubTxID subTxID, const std::vector<std::pair<TxParameterID, ByteBuffer>>& params, bool shouldNotifyAboutChanges)
+    {
+        // all rows go into the pending db transaction, it's committed by the flush timer
+        bool hasTx = shouldNotifyAboutChanges && getTx(txID).is_initialized();
+        bool changed = false;
+        bool summaryChanged = false;
+        for (const auto& p : params)
+        {
+            if (setTxParameterRaw(txID, subTxID, p.first, p.second))
+            {
+                changed = true;
+                summaryChanged |= IsTxSummaryParam(p.first);
+            }
+        }
+
+        // refresh the summary row once per batch
+        if ((kDefaultSubTxID == subTxID) && summaryChanged)
+            updateTxSummary(txID);
+
+        if (changed && shouldNotifyAboutChanges)
+        {
+            auto tx = getTx(txID);
+            if (tx.is_initialized())
+            {
+                notifyTransactionChanged(hasTx ? ChangeAction::Updated : ChangeAction::Added, { *tx });
+            }
+        }
+        return changed;
+    }
+
+    bool WalletDB::setTxParameterRaw(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob)
     {
         if (auto txIter = m_TxParametersCache.find(txID); txIter != m_TxParametersCache.end())
         {
@@ -2041,7 +2351,6 @@ namespace grimm::wallet
             }
         }
 
-        bool hasTx = getTx(txID).is_initialized();
         {
             sqlite::Statement stm(this, "SELECT * FROM " TX_PARAMS_NAME " WHERE txID=?1 AND subTxID=?2 AND paramID=?3;");
 
@@ -2064,14 +2373,6 @@ namespace grimm::wallet
                 stm2.bind(4, blob);
                 stm2.step();
 
-                if (shouldNotifyAboutChanges)
-                {
-                    auto tx = getTx(txID);
-                    if (tx.is_initialized())
-                    {
-                        notifyTransactionChanged(ChangeAction::Updated, { *tx });
-                    }
-                }
                 insertParameterToCache(txID, subTxID, paramID, blob);
                 return true;
             }
@@ -2086,14 +2387,7 @@ namespace grimm::wallet
         int colIdx = 0;
         ENUM_TX_PARAMS_FIELDS(STM_BIND_LIST, NOSEP, parameter);
         stm.step();
-        if (shouldNotifyAboutChanges)
-        {
-            auto tx = getTx(txID);
-            if (tx.is_initialized())
-            {
-                notifyTransactionChanged(hasTx ? ChangeAction::Updated : ChangeAction::Added, { *tx });
-            }
-        }
+
         insertParameterToCache(txID, subTxID, paramID, blob);
         return true;
     }
@@ -2186,6 +2480,19 @@ namespace grimm::wallet
         }
     }
 
+    void WalletDB::finalizeStatements()
+    {
+        for (auto& statements : m_Statements)
+        {
+            for (auto& x : statements)
+            {
+                assert(!x.second.m_InUse);
+                sqlite3_finalize(x.second.m_pStm);
+            }
+            statements.clear();
+        }
+    }
+
     void WalletDB::notifyCoinsChanged()
     {
         for (auto sub : m_subscribers) sub->onCoinsChanged();
@@ -2265,7 +2572,15 @@ namespace grimm::wallet
 
         stm.step();
 
-        return sqlite3_changes(_db) > 0;
+        if (sqlite3_changes(_db) <= 0)
+            return false;
+
+        for (auto& x : m_SpendableCoins)
+        {
+            if (x.second.m_sessionId == session)
+                x.second.m_sessionId = 0;
+        }
+        return true;
     }
 
     CoinIDList WalletDB::getLocked(uint64_t session) const
@@ -30,8 +30,10 @@
 #include "wallet/common.h"
 #include "utility/io/address.h"
 #include "secstring.h"
+#include <unordered_map>
 
 struct sqlite3;
+struct sqlite3_stmt;
 
 namespace grimm::wallet
 {
@@ -153,6 +155,22 @@ namespace grimm::wallet
 
     };
 
+    // Transaction history request, served from the tx summary table.
+    // Transactions are returned newest first (by create time, then by id).
+    struct TxHistoryQuery
+    {
+        wallet::TxType m_TxType = wallet::TxType::ALL;
+        boost::optional<TxStatus> m_Status;
+        boost::optional<WalletID> m_PeerID;
+        Height m_HeightMin = 0; // kernel proof height range, inclusive
+        Height m_HeightMax = MaxHeight;
+
+        // keyset pagination: continue after the last tx of the previous page
+        boost::optional<TxDescription> m_After;
+        uint64_t m_Skip = 0;
+        int m_Count = std::numeric_limits<int>::max();
+    };
+
     struct IWalletDbObserver
     {
         virtual void onCoinsChanged() {};
@@ -241,11 +259,15 @@ namespace grimm::wallet
         // /////////////////////////////////////////////
         // Transaction management
         virtual std::vector<TxDescription> getTxHistory(wallet::TxType txType = wallet::TxType::Simple, uint64_t start = 0, int count = std::numeric_limits<int>::max()) = 0;
+        virtual std::vector<TxDescription> getTxHistoryPage(const TxHistoryQuery&) = 0;
         virtual boost::optional<TxDescription> getTx(const TxID& txId) = 0;
         virtual void saveTx(const TxDescription& p) = 0;
         virtual void deleteTx(const TxID& txId) = 0;
         virtual bool setTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID,
             const ByteBuffer& blob, bool shouldNotifyAboutChanges) = 0;
+        // writes several parameters of the same tx at once, notifies at most once
+        virtual bool setTxParameters(const TxID& txID, SubTxID subTxID,
+            const std::vector<std::pair<TxParameterID, ByteBuffer>>& params, bool shouldNotifyAboutChanges) = 0;
         virtual bool getTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID, ByteBuffer& blob) const = 0;
         virtual void rollbackTx(const TxID& txId) = 0;
 
@@ -328,6 +350,7 @@ namespace grimm::wallet
         void rollbackConfirmedUtxo(Height minHeight) override;
 
         std::vector<TxDescription> getTxHistory(wallet::TxType txType, uint64_t start, int count) override;
+        std::vector<TxDescription> getTxHistoryPage(const TxHistoryQuery&) override;
         boost::optional<TxDescription> getTx(const TxID& txId) override;
         void saveTx(const TxDescription& p) override;
         void deleteTx(const TxID& txId) override;
@@ -349,6 +372,8 @@ namespace grimm::wallet
 
         bool setTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID,
             const ByteBuffer& blob, bool shouldNotifyAboutChanges) override;
+        bool setTxParameters(const TxID& txID, SubTxID subTxID,
+            const std::vector<std::pair<TxParameterID, ByteBuffer>>& params, bool shouldNotifyAboutChanges) override;
         bool getTxParameter(const TxID& txID, SubTxID subTxID, TxParameterID paramID, ByteBuffer& blob) const override;
 
         Block::SystemState::IHistory& get_History() override;
@@ -366,6 +391,10 @@ namespace grimm::wallet
         uint64_t saveIncomingWalletMessage(BbsChannel channel, const ByteBuffer& message) override;
         void deleteIncomingWalletMessage(uint64_t id) override;
 
+        // Bounds the number of coins passed to the selection algorithm, 0 - unbounded.
+        // The coins closest to the requested amount are considered first, all of them only if those aren't enough.
+        void setCoinSelectionLimit(size_t nMaxCandidates);
+
     private:
         void removeImpl(const Coin::ID& cid);
         void notifyCoinsChanged();
@@ -378,6 +407,8 @@ namespace grimm::wallet
         void insertRaw(const Coin&);
         void insertNew(Coin&);
         void saveRaw(const Coin&);
+        bool setTxParameterRaw(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const ByteBuffer& blob);
+        void updateTxSummary(const TxID& txID);
 
         // ////////////////////////////////////////
         // Cache for optimized access for database fields
@@ -391,6 +422,7 @@ namespace grimm::wallet
         void onModified();
         void onFlushTimer();
         void onPrepareToModify();
+        void finalizeStatements();
     private:
         friend struct sqlite::Statement;
         sqlite3* _db;
@@ -416,6 +448,37 @@ namespace grimm::wallet
 
         mutable ParameterCache m_TxParametersCache;
         mutable std::map<WalletID, boost::optional<WalletAddress>> m_AddressesCache;
+
+        // Confirmed unspent coins ordered by amount, maintained along with the coins table.
+        // Maturity and the state of the spending tx are checked upon selection.
+        struct CoinsByAmount
+        {
+            bool operator()(const Coin::ID& a, const Coin::ID& b) const
+            {
+                if (a.m_Value != b.m_Value)
+                    return a.m_Value < b.m_Value;
+                return a.cmp(b) < 0;
+            }
+        };
+        using SpendableCoins = std::map<Coin::ID, Coin, CoinsByAmount>;
+
+        const SpendableCoins& get_SpendableCoins();
+        void updateSpendableCoin(const Coin&);
+        void removeSpendableCoin(const Coin::ID&);
+        void resetSpendableCoins();
+
+        SpendableCoins m_SpendableCoins;
+        bool m_SpendableCoinsValid = false;
+        size_t m_MaxSelectCandidates = 0;
+
+        // Prepared statements, keyed by SQL text, one set per connection (main/private).
+        // A statement is borrowed by sqlite::Statement and returned reset on its destruction.
+        struct CachedStatement
+        {
+            sqlite3_stmt* m_pStm = nullptr;
+            bool m_InUse = false;
+        };
+        mutable std::unordered_map<std::string, CachedStatement> m_Statements[2];
     };
 
     namespace storage